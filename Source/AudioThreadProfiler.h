@@ -0,0 +1,184 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Per-stage timing of the audio callback, kept as log-scale histograms.
+
+    The audio thread is the only writer and only ever does relaxed atomic stores, so
+    recording is wait-free; any other thread may read a summary at any time. Buckets
+    have eight steps per octave (about 9% resolution) from 1 ns to ~4 s.
+*/
+class AudioThreadProfiler
+{
+
+public:
+
+    enum Stage
+    {
+        oscillator,     //rendering the internal oscillator or the MIDI voices
+        design,         //picking up a new filter design and setting up the ramp
+        vocoder,        //modulator analysis and carrier synthesis, which share one pass
+        mix,            //channel copies, bypass and output gain
+        block,          //the whole block
+        numStages
+    };
+
+    struct Summary
+    {
+        uint64_t count;
+        double meanNs, p50Ns, p90Ns, p99Ns, p999Ns, maxNs;
+    };
+
+
+    AudioThreadProfiler()
+        : nanosecondsPerTick(1.0e9 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()))
+    {
+        reset();
+    }
+
+
+    static char const* getStageName(int stage)
+    {
+        static char const* const names[] = {"oscillator", "design", "vocoder", "mix", "block"};
+        return names[stage];
+    }
+
+
+    /** Recording is off by default; when off, a ScopedStage costs one atomic load. */
+    void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+    bool isEnabled() const                { return enabled.load(std::memory_order_relaxed); }
+
+
+    /** Times the enclosing scope as one sample of the given stage. Audio thread only. */
+    struct ScopedStage
+    {
+        ScopedStage(AudioThreadProfiler& p, Stage s)
+            : profiler(p), stage(s), start(p.isEnabled() ? juce::Time::getHighResolutionTicks() : 0) {}
+
+        ~ScopedStage()
+        {
+            if (start != 0){profiler.record(stage, juce::Time::getHighResolutionTicks() - start);}
+        }
+
+        AudioThreadProfiler& profiler;
+        Stage const stage;
+        juce::int64 const start;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedStage)
+    };
+
+
+    /** Clears all histograms. Samples recorded concurrently may land on either side. */
+    void reset()
+    {
+        for(auto& stage : stages)
+        {
+            for(auto& bucket : stage.buckets){bucket.store(0, std::memory_order_relaxed);}
+            stage.count.store(0, std::memory_order_relaxed);
+            stage.totalNs.store(0, std::memory_order_relaxed);
+            stage.maxNs.store(0, std::memory_order_relaxed);
+        }
+    }
+
+
+    /** Percentiles are the lower edge of the bucket they fall in. */
+    Summary getSummary(int stage) const
+    {
+        auto const& s = stages[stage];
+
+        std::array<uint64_t, numBuckets> buckets;
+        uint64_t count = 0;
+
+        for(int i = 0; i < numBuckets; i++)
+        {
+            buckets[i] = s.buckets[i].load(std::memory_order_relaxed);
+            count += buckets[i];
+        }
+
+        auto const percentile = [&] (double fraction)
+        {
+            auto const rank = static_cast<uint64_t>(fraction * static_cast<double>(count));
+            uint64_t below  = 0;
+
+            for(int i = 0; i < numBuckets; i++)
+            {
+                below += buckets[i];
+                if (below > rank){return static_cast<double>(getBucketFloor(i));}
+            }
+
+            return static_cast<double>(getBucketFloor(numBuckets - 1));
+        };
+
+        Summary summary;
+        summary.count  = count;
+        summary.meanNs = count > 0 ? static_cast<double>(s.totalNs.load(std::memory_order_relaxed)) / static_cast<double>(count) : 0.0;
+        summary.p50Ns  = percentile(0.5);
+        summary.p90Ns  = percentile(0.9);
+        summary.p99Ns  = percentile(0.99);
+        summary.p999Ns = percentile(0.999);
+        summary.maxNs  = static_cast<double>(s.maxNs.load(std::memory_order_relaxed));
+        return summary;
+    }
+
+
+private:
+
+    int constexpr static stepsPerOctave = 8;
+    int constexpr static numBuckets     = 32 * stepsPerOctave;
+
+    struct StageHistogram
+    {
+        std::array<std::atomic<uint32_t>, numBuckets> buckets;
+        std::atomic<uint64_t> count, totalNs, maxNs;
+    };
+
+    std::atomic<bool> enabled{false};
+    double const nanosecondsPerTick;
+    std::array<StageHistogram, numStages> stages;
+
+
+    //Single writer, so plain load + store is enough and never loops
+    template <typename Type>
+    static void increment(std::atomic<Type>& value, Type amount)
+    {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+
+    void record(Stage stage, juce::int64 ticks)
+    {
+        auto const ns = static_cast<uint32_t>(juce::jlimit(0.0, 4.0e9, static_cast<double>(ticks) * nanosecondsPerTick));
+        auto& s = stages[stage];
+
+        increment(s.buckets[getBucket(ns)], 1u);
+        increment(s.count, uint64_t{1});
+        increment(s.totalNs, uint64_t{ns});
+
+        if (ns > s.maxNs.load(std::memory_order_relaxed)){s.maxNs.store(ns, std::memory_order_relaxed);}
+    }
+
+
+    /** Values below stepsPerOctave get a bucket each; above, each octave splits into stepsPerOctave. */
+    static int getBucket(uint32_t ns)
+    {
+        if (ns < stepsPerOctave){return static_cast<int>(ns);}
+
+        int const octave = juce::findHighestSetBit(ns);
+        int const step   = static_cast<int>((ns >> (octave - 3)) & (stepsPerOctave - 1));
+
+        return juce::jmin(numBuckets - 1, (octave - 2) * stepsPerOctave + step);
+    }
+
+
+    static uint64_t getBucketFloor(int bucket)
+    {
+        if (bucket < stepsPerOctave){return static_cast<uint64_t>(bucket);}
+
+        int const octave = bucket / stepsPerOctave + 2;
+        int const step   = bucket % stepsPerOctave;
+
+        return static_cast<uint64_t>(stepsPerOctave + step) << (octave - 3);
+    }
+};
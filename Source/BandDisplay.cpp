@@ -0,0 +1,85 @@
+#include "BandDisplay.h"
+
+//Definitions for the constants that get bound to references, which C++14 needs out of class
+float constexpr BandDisplay::minDecibels;
+float constexpr BandDisplay::maxDecibels;
+float constexpr BandDisplay::fallPerFrame;
+
+BandDisplay::BandDisplay(BandMeter& meterToShow)
+: meter(meterToShow)
+{
+    shown.fill(minDecibels);
+
+    setOpaque(true);
+
+    //Everything is drawn in renderOpenGL(); continuous repainting follows the display's refresh rate
+    context.setRenderer(this);
+    context.setComponentPaintingEnabled(false);
+    context.setContinuousRepainting(true);
+    context.attachTo(*this);
+
+    meter.setActive(true);
+}
+
+
+BandDisplay::~BandDisplay()
+{
+    meter.setActive(false);
+    context.detach();
+}
+
+
+void BandDisplay::renderOpenGL()
+{
+    if (meter.pullLatest(frame))
+    {
+        numShown = frame.numBands;
+
+        for(int band = 0; band < numShown; band++)
+        {
+            auto const level = juce::Decibels::gainToDecibels(frame.levels[static_cast<size_t>(band)], minDecibels);
+            auto& bar        = shown[static_cast<size_t>(band)];
+
+            bar = juce::jmax(level, bar - fallPerFrame);
+        }
+    }
+    else
+    {
+        for(int band = 0; band < numShown; band++)
+        {
+            auto& bar = shown[static_cast<size_t>(band)];
+            bar = juce::jmax(minDecibels, bar - fallPerFrame);
+        }
+    }
+
+    juce::OpenGLHelpers::clear(juce::Colour(0xff15181c));
+
+    if (numShown == 0){return;}
+
+    auto const scale  = static_cast<float>(context.getRenderingScale());
+    auto const width  = juce::roundToInt(scale * static_cast<float>(getWidth()));
+    auto const height = juce::roundToInt(scale * static_cast<float>(getHeight()));
+
+    auto const barWidth = static_cast<float>(width) / static_cast<float>(numShown);
+    auto const gap      = barWidth > 4.f ? 1 : 0;
+
+    //Every bar is a solid rectangle, so clearing it through the scissor box draws it without
+    //a graphics context, shader or vertex buffer to set up each frame
+    glEnable(GL_SCISSOR_TEST);
+
+    for(int band = 0; band < numShown; band++)
+    {
+        auto const proportion = juce::jmap(shown[static_cast<size_t>(band)], minDecibels, maxDecibels, 0.f, 1.f);
+        auto const barHeight  = juce::roundToInt(juce::jlimit(0.f, 1.f, proportion) * static_cast<float>(height));
+
+        auto const left  = juce::roundToInt(static_cast<float>(band) * barWidth);
+        auto const right = juce::roundToInt(static_cast<float>(band + 1) * barWidth) - gap;
+        if (barHeight == 0 || right <= left){continue;}
+
+        //The scissor box is in window pixels from the bottom left, where the bars stand
+        glScissor(left, 0, right - left, barHeight);
+        juce::OpenGLHelpers::clear(juce::Colour::fromHSV(0.55f - 0.4f * static_cast<float>(band) / static_cast<float>(numShown), 0.7f, 0.9f, 1.f));
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "BandMeter.h"
+
+//==============================================================================
+/**
+    Bar display of the band levels, drawn by an OpenGL context on its own render
+    thread. That thread is the meter's only reader: it drains the FIFO once per frame,
+    so neither the audio thread nor the message thread does any work for the display.
+*/
+class BandDisplay  : public juce::Component,
+                     private juce::OpenGLRenderer
+{
+public:
+
+    explicit BandDisplay(BandMeter& meterToShow);
+    ~BandDisplay();
+
+private:
+
+    //Levels are shown in dB over this range
+    float constexpr static minDecibels = -60.f;
+    float constexpr static maxDecibels = 12.f;
+
+    //How far a bar may fall per frame, in dB; rises are shown at once
+    float constexpr static fallPerFrame = 1.5f;
+
+    BandMeter& meter;
+    juce::OpenGLContext context;
+
+    //Only touched on the render thread
+    BandMeter::Frame frame;
+    std::array<float, BandMeter::maxBands> shown;
+    int numShown{};
+
+    void newOpenGLContextCreated() override {}
+    void renderOpenGL() override;
+    void openGLContextClosing() override {}
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BandDisplay)
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterBank.h"
+
+//==============================================================================
+/**
+    Carries per-band levels from the audio thread to the editor.
+
+    Whole frames go through a small ring guarded by a juce::AbstractFifo, with one
+    writer and one reader, so neither side ever waits: if the reader falls behind, new
+    frames are dropped. Frames are written at a fixed rate whatever the block size,
+    and only while an editor has switched the meter on, so a closed editor costs the
+    audio thread nothing.
+*/
+class BandMeter
+{
+
+public:
+
+    int constexpr static maxBands = FilterBankDesign::maxSpectralBands;
+    int constexpr static capacity = 8;
+
+    //Twice the display rate, so every refresh finds a fresh frame
+    double constexpr static framesPerSecond = 120.0;
+
+    struct Frame
+    {
+        int numBands{};
+        std::array<float, maxBands> levels{};
+    };
+
+
+    /** Not realtime safe; call before processing starts. */
+    void prepare(double sampleRate)
+    {
+        samplesPerFrame = juce::jmax(1, juce::roundToInt(sampleRate / framesPerSecond));
+        untilFrame      = samplesPerFrame;
+    }
+
+
+    void setActive(bool shouldBeActive) { active = shouldBeActive; }
+    bool isActive() const               { return active.load(); }
+
+
+    /** Audio thread only. Counts the block and returns true if a frame is due. */
+    bool advance(int numSamples)
+    {
+        if (! active.load(std::memory_order_relaxed)){return false;}
+
+        untilFrame -= numSamples;
+        if (untilFrame > 0){return false;}
+
+        untilFrame = samplesPerFrame;
+        return true;
+    }
+
+
+    /** Audio thread only. Writes one frame, taking each band's level from getLevel(band). */
+    template <typename GetLevel>
+    void push(int numBands, GetLevel&& getLevel)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 == 0){return;}
+
+        auto& frame    = frames[static_cast<size_t>(start1)];
+        frame.numBands = juce::jmin(numBands, maxBands);
+
+        for(int band = 0; band < frame.numBands; band++){frame.levels[static_cast<size_t>(band)] = getLevel(band);}
+
+        fifo.finishedWrite(1);
+    }
+
+
+    /** Reader only. Copies the newest frame and discards any older ones; returns false if
+        nothing arrived since the last call. */
+    bool pullLatest(Frame& frame)
+    {
+        int const numReady = fifo.getNumReady();
+        if (numReady == 0){return false;}
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+        frame = frames[static_cast<size_t>(size2 > 0 ? start2 + size2 - 1 : start1 + size1 - 1)];
+
+        fifo.finishedRead(size1 + size2);
+        return true;
+    }
+
+
+private:
+
+    juce::AbstractFifo fifo{capacity};
+    std::array<Frame, capacity> frames;
+
+    std::atomic<bool> active{false};
+    int samplesPerFrame{1};
+    int untilFrame{1};
+
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+#if JUCE_LINUX || JUCE_ANDROID
+ #include <semaphore.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#endif
+
+//==============================================================================
+/**
+    Small fixed pool of worker threads for splitting one block of filter-bank work
+    into independent tasks.
+
+    The caller publishes a job and then claims tasks itself alongside the workers, so
+    a job always completes even if no worker wakes up in time; the caller only ever
+    waits for tasks that a worker is already running. After a job a worker spins for a
+    few microseconds in case the next block follows straight away, then parks on its
+    own semaphore and uses no CPU until run() posts it. Posting a semaphore does not
+    lock or allocate, and run() only does it for workers that are actually parked.
+
+    There is one pool per process, shared by every engine that acquires it and stopped
+    when the last of them releases it. A job arriving while another engine's job is
+    running is done on the calling thread alone instead of waiting for the workers.
+*/
+class BandWorkerPool
+{
+
+public:
+
+    using TaskFunction = void (*)(void* context, int task);
+
+
+    /** The process-wide pool, started with numWorkers threads if nobody holds it yet,
+        or nullptr if numWorkers is not positive. Every pool returned must be handed back
+        to release() once. Never call from the audio thread. */
+    static BandWorkerPool* acquire(int numWorkers)
+    {
+        if (numWorkers <= 0){return nullptr;}
+
+        auto& shared = getShared();
+        const juce::ScopedLock lock(shared.lock);
+
+        if (shared.users++ == 0){shared.pool = std::make_unique<BandWorkerPool>(numWorkers);}
+        return shared.pool.get();
+    }
+
+
+    /** Hands back a pool from acquire(); the last user to do so stops its threads, so
+        nobody may be inside run() on it any more. Never call from the audio thread. */
+    static void release()
+    {
+        auto& shared = getShared();
+        std::unique_ptr<BandWorkerPool> stopped;
+
+        {
+            const juce::ScopedLock lock(shared.lock);
+            if (--shared.users == 0){stopped = std::move(shared.pool);}
+        }
+    }
+
+
+    explicit BandWorkerPool(int numWorkers)
+    {
+        for(int i = 0; i < numWorkers; i++)
+        {
+            workers.add(new Worker(*this));
+            workers.getLast()->startThread(9);
+        }
+    }
+
+
+    ~BandWorkerPool()
+    {
+        for(auto* worker : workers){worker->signalThreadShouldExit();}
+        for(auto* worker : workers){worker->wake();}
+        for(auto* worker : workers){worker->stopThread(1000);}
+    }
+
+
+    int getNumWorkers() const { return workers.size(); }
+
+
+    /** Runs function(context, task) for every task in [0, numTasks) and returns when all
+        of them have finished. Tasks may run in any order and on any thread. */
+    void run(int numTasks, TaskFunction function, void* context)
+    {
+        //Another engine has the workers, so this job is done here rather than queued behind it
+        if (busy.exchange(true, std::memory_order_acquire))
+        {
+            for(int task = 0; task < numTasks; task++){function(context, task);}
+            return;
+        }
+
+        jobFunction = function;
+        jobContext  = context;
+        finished.store(0, std::memory_order_relaxed);
+
+        //Nothing can be claimed until jobTasks is set, so a late worker never sees half a job
+        generation++;
+        work.store(static_cast<uint64_t>(generation) << 32);
+        jobTasks.store(numTasks);
+
+        for(auto* worker : workers){worker->wake();}
+
+        while (runTasks()){}
+
+        while (finished.load(std::memory_order_acquire) < numTasks){pause();}
+
+        jobTasks.store(0, std::memory_order_relaxed);
+        busy.store(false, std::memory_order_release);
+    }
+
+
+private:
+
+    /** Counting semaphore a parked worker waits on. */
+    class Semaphore
+    {
+    public:
+
+       #if JUCE_LINUX || JUCE_ANDROID
+        Semaphore()  { sem_init(&semaphore, 0, 0); }
+        ~Semaphore() { sem_destroy(&semaphore); }
+
+        void post() { sem_post(&semaphore); }
+        void wait() { while (sem_wait(&semaphore) != 0){} }
+
+    private:
+
+        sem_t semaphore;
+       #elif JUCE_MAC || JUCE_IOS
+        Semaphore()  : semaphore(dispatch_semaphore_create(0)) {}
+        ~Semaphore() { dispatch_release(semaphore); }
+
+        void post() { dispatch_semaphore_signal(semaphore); }
+        void wait() { dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER); }
+
+    private:
+
+        dispatch_semaphore_t semaphore;
+       #else
+        void post() { event.signal(); }
+        void wait() { event.wait(); }
+
+    private:
+
+        juce::WaitableEvent event;
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE(Semaphore)
+    };
+
+
+    struct Worker : public juce::Thread
+    {
+        explicit Worker(BandWorkerPool& p) : juce::Thread("Vocoder band worker"), pool(p) {}
+
+        void run() override
+        {
+            int idle = 0;
+
+            while (! threadShouldExit())
+            {
+                if (pool.runTasks())
+                {
+                    idle = 0;
+                    continue;
+                }
+
+                if (++idle < spinIterations)
+                {
+                    pause();
+                    continue;
+                }
+
+                idle = 0;
+
+                //The flag goes up before the last look for work, so a job published meanwhile
+                //is either seen here or finds the flag and posts
+                parked.store(true);
+
+                if (pool.hasWork() || threadShouldExit())
+                {
+                    //If wake() took the flag first its post is on the way and has to be consumed
+                    if (! parked.exchange(false)){semaphore.wait();}
+                    continue;
+                }
+
+                semaphore.wait();
+            }
+        }
+
+        /** Posts the worker if it is parked; does nothing otherwise. */
+        void wake()
+        {
+            if (parked.exchange(false)){semaphore.post();}
+        }
+
+        BandWorkerPool& pool;
+        std::atomic<bool> parked{false};
+        Semaphore semaphore;
+    };
+
+    struct Shared
+    {
+        juce::CriticalSection lock;
+        std::unique_ptr<BandWorkerPool> pool;
+        int users{0};
+    };
+
+    int constexpr static spinIterations = 4000;
+
+    juce::OwnedArray<Worker> workers;
+
+    //Upper 32 bits: job generation, lower 32 bits: next task to claim. Claiming through a
+    //compare-exchange on both halves means a late worker can never take a task of a newer job
+    std::atomic<uint64_t> work{0};
+    std::atomic<int> jobTasks{0};
+    std::atomic<int> finished{0};
+    std::atomic<bool> busy{false};
+
+    uint32_t generation{0};
+    TaskFunction jobFunction = nullptr;
+    void* jobContext = nullptr;
+
+
+    static Shared& getShared()
+    {
+        static Shared shared;
+        return shared;
+    }
+
+
+    static void pause()
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #endif
+    }
+
+
+    bool hasWork() const
+    {
+        return static_cast<int>(work.load() & 0xffffffffu) < jobTasks.load();
+    }
+
+
+    /** Claims and runs one task of the current job; returns false if there was none left. */
+    bool runTasks()
+    {
+        auto current = work.load(std::memory_order_acquire);
+
+        while (static_cast<int>(current & 0xffffffffu) < jobTasks.load(std::memory_order_acquire))
+        {
+            if (work.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel))
+            {
+                //The job cannot be replaced before this task reports back, so these are stable
+                jobFunction(jobContext, static_cast<int>(current & 0xffffffffu));
+                finished.fetch_add(1, std::memory_order_acq_rel);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+};
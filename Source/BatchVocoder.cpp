@@ -0,0 +1,418 @@
+#include "BatchVocoder.h"
+
+void BatchVocoder::prepare(double newSampleRate, int newMaxStreams, BandLayout layout)
+{
+    RealtimeCheck::assertNotRealtime("BatchVocoder::prepare");
+
+    sampleRate = newSampleRate;
+    maxStreams = juce::jmax(0, newMaxStreams);
+    numGroups  = (maxStreams + streamsPerVec - 1) / streamsPerVec;
+    groups.reset(new Group[static_cast<size_t>(numGroups)]);
+
+    osc_.prepare(sampleRate);
+    setBandLayout(layout);
+    reset();
+}
+
+
+void BatchVocoder::setBandLayout(BandLayout layout)
+{
+    RealtimeCheck::assertNotRealtime("BatchVocoder::setBandLayout");
+
+    layout.sampleRate = sampleRate;
+    design = DesignCache::get(layout);
+    bands  = design->getDesign();
+
+    for(int b = 0; b < maxBands; b++)
+    {
+        for(int s = 0; s < maxSections; s++)
+        {
+            auto const& c = bands.bands[b].sections[static_cast<size_t>(s)];
+            auto* section = coefficients.data() + 5 * s;
+
+            section[0][b] = Vec::expand(c.b0);
+            section[1][b] = Vec::expand(c.b1);
+            section[2][b] = Vec::expand(c.b2);
+            section[3][b] = Vec::expand(c.a1);
+            section[4][b] = Vec::expand(c.a2);
+        }
+    }
+
+    //Bands and sections that drop out start from rest if a later layout brings them back
+    for(int g = 0; g < numGroups; g++)
+    {
+        clearBands(groups[g], bands.numBands);
+        clearBands(groups[g], 0, bands.numSections);
+    }
+
+    for(int b = 0; b < maxBands; b++)
+    {
+        for(int i = b < bands.numBands ? 2 * bands.numSections : 0; i < 2 * maxSections; i++){carrierStates[b][i] = 0.f;}
+    }
+}
+
+
+void BatchVocoder::reset()
+{
+    for(int g = 0; g < numGroups; g++)
+    {
+        clearBands(groups[g], 0);
+        groups[g].idle = true;
+    }
+
+    for(auto& states : carrierStates){states.fill(0.f);}
+    untilGainUpdate = 0;
+}
+
+
+void BatchVocoder::resetStream(int stream)
+{
+    jassert(stream >= 0 && stream < maxStreams);
+
+    clearLane(groups[stream / streamsPerVec], stream % streamsPerVec);
+}
+
+
+void BatchVocoder::process(float const* const* modulators, float* const* outputs, int numStreams,
+                           int numSamples, VocoderParameters const& parameters)
+{
+    process(modulators, nullptr, outputs, numStreams, numSamples, parameters);
+}
+
+
+void BatchVocoder::process(float const* const* modulators, float const* const* carriers, float* const* outputs,
+                           int numStreams, int numSamples, VocoderParameters const& parameters)
+{
+    jassert(numStreams <= maxStreams);
+    numStreams = juce::jmin(numStreams, maxStreams);
+
+    if (numStreams <= 0 || numSamples <= 0){return;}
+
+    //Same time constants as FilterBank::setEnvelope()
+    auto const coefficient = [this](float ms)
+    {
+        return static_cast<float>(1.0 - std::exp(-1000.0 / (juce::jmax(0.01f, ms) * sampleRate)));
+    };
+
+    auto const attack  = coefficient(parameters.attack);
+    auto const release = coefficient(parameters.release);
+
+    envelopeMean     = Vec::expand(0.5f * (attack + release));
+    envelopeHalfDiff = Vec::expand(0.5f * (attack - release));
+    detector         = parameters.detector == 0 ? FilterBank::Detector::rms : FilterBank::Detector::peak;
+
+    for (int position = 0; position < numSamples; position += blockSize)
+    {
+        processBlock(modulators, carriers, outputs, numStreams, position,
+                     juce::jmin(blockSize, numSamples - position), parameters);
+    }
+}
+
+
+void BatchVocoder::processBlock(float const* const* modulators, float const* const* carriers, float* const* outputs,
+                                int numStreams, int start, int numSamples, VocoderParameters const& parameters)
+{
+    if (carriers == nullptr){renderCarrier(numSamples, parameters);}
+
+    for (int first = 0; first < numStreams; first += streamsPerVec)
+    {
+        processGroup(groups[first / streamsPerVec], first, juce::jmin(streamsPerVec, numStreams - first),
+                     modulators, carriers, outputs, start, numSamples, parameters);
+    }
+
+    //Every group follows the same update grid, advanced as FilterBank::endBlock() does
+    if (untilGainUpdate == 0){untilGainUpdate = FilterBank::controlInterval;}
+
+    untilGainUpdate -= numSamples;
+    while (untilGainUpdate < 0){untilGainUpdate += FilterBank::controlInterval;}
+}
+
+
+void BatchVocoder::renderCarrier(int numSamples, VocoderParameters const& parameters)
+{
+    osc_.setWaveform(parameters.oscWave);
+    osc_.setFrequency(parameters.oscFreq);
+    osc_.render(oscOutput.data(), numSamples);
+
+    for(int b = 0; b < bands.numBands; b++)
+    {
+        auto* y = carrierBands[b].data();
+        std::copy(oscOutput.begin(), oscOutput.begin() + numSamples, y);
+
+        //A whole block per section, in place
+        for(int s = 0; s < bands.numSections; s++)
+        {
+            auto const& c = bands.bands[b].sections[static_cast<size_t>(s)];
+            auto s1 = carrierStates[b][2 * s];
+            auto s2 = carrierStates[b][2 * s + 1];
+
+            for(int i = 0; i < numSamples; i++)
+            {
+                auto const x = y[i];
+                y[i] = c.b0 * x + s1;
+                s1 = c.b1 * x - c.a1 * y[i] + s2;
+                s2 = c.b2 * x - c.a2 * y[i];
+            }
+
+            carrierStates[b][2 * s]     = s1;
+            carrierStates[b][2 * s + 1] = s2;
+        }
+    }
+}
+
+
+void BatchVocoder::processGroup(Group& group, int firstStream, int numLanes, float const* const* modulators,
+                                float const* const* carriers, float* const* outputs, int start, int numSamples,
+                                VocoderParameters const& parameters)
+{
+    //Lanes past the last stream are fed silence and their output is dropped
+    alignas(Vec) float values[streamsPerVec] = {};
+    bool silent = true;
+
+    for (int lane = 0; lane < numLanes; lane++)
+    {
+        auto const range = juce::FloatVectorOperations::findMinAndMax(modulators[firstStream + lane] + start, numSamples);
+        silent = silent && range.getStart() >= -FilterBank::silenceLevel && range.getEnd() <= FilterBank::silenceLevel;
+    }
+
+    //Sample by sample with one stream per lane; this also makes an output that aliases its modulator safe
+    for (int i = 0; i < numSamples; i++)
+    {
+        for (int lane = 0; lane < numLanes; lane++){values[lane] = modulators[firstStream + lane][start + i];}
+        modLanes[i] = Vec::fromRawArray(values);
+    }
+
+    if (carriers != nullptr)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            for (int lane = 0; lane < numLanes; lane++){values[lane] = carriers[firstStream + lane][start + i];}
+            carLanes[i] = Vec::fromRawArray(values);
+        }
+    }
+
+    for (int i = 0; i < numSamples; i++){outLanes[i] = Vec::expand(0.f);}
+
+    //Once a whole group has died away, silent input gives silent output without running its bands
+    if (! (silent && group.idle))
+    {
+        using Kernel = void (BatchVocoder::*)(Group&, int, int);
+
+        //Indexed by the carrier, the detector and whether bands are cascaded
+        static Kernel const kernels[] = { &BatchVocoder::processBands<true, true, false>,   &BatchVocoder::processBands<true, true, true>,
+                                          &BatchVocoder::processBands<true, false, false>,  &BatchVocoder::processBands<true, false, true>,
+                                          &BatchVocoder::processBands<false, true, false>,  &BatchVocoder::processBands<false, true, true>,
+                                          &BatchVocoder::processBands<false, false, false>, &BatchVocoder::processBands<false, false, true> };
+
+        bool const rms = detector == FilterBank::Detector::rms;
+        Kernel const kernel = kernels[(carriers == nullptr ? 0 : 4) + (rms ? 0 : 2) + (bands.numSections > 1 ? 1 : 0)];
+
+        int untilUpdate = untilGainUpdate;
+        int position    = 0;
+
+        while (position < numSamples)
+        {
+            if (untilUpdate == 0)
+            {
+                updateGainTargets(group, parameters.rmsGain);
+                untilUpdate = FilterBank::controlInterval;
+            }
+
+            int const chunk = juce::jmin(untilUpdate, numSamples - position);
+            (this->*kernel)(group, position, chunk);
+
+            untilUpdate -= chunk;
+            position    += chunk;
+        }
+
+        if (silent){settle(group);}
+        else       {group.idle = false;}
+    }
+
+    if (parameters.bypassMod)
+    {
+        for (int i = 0; i < numSamples; i++){outLanes[i] = carriers != nullptr ? carLanes[i] : Vec::expand(oscOutput[i]);}
+    }
+
+    auto const outGain = Vec::expand(parameters.outGain);
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        (outLanes[i] * outGain).copyToRawArray(values);
+        for (int lane = 0; lane < numLanes; lane++){outputs[firstStream + lane][start + i] = values[lane];}
+    }
+}
+
+
+void BatchVocoder::updateGainTargets(Group& group, float modGain)
+{
+    auto const scale = Vec::expand(modGain);
+    auto const rate  = Vec::expand(1.f / static_cast<float>(FilterBank::controlInterval));
+
+    //Every lane of every band in one flat run, so the square roots are not taken lane by lane
+    alignas(Vec) float levels[maxBands * streamsPerVec];
+    int const numLevels = bands.numBands * streamsPerVec;
+
+    for(int b = 0; b < bands.numBands; b++){group.envelope[b].copyToRawArray(levels + b * streamsPerVec);}
+
+    if (detector == FilterBank::Detector::rms)
+    {
+        for(int i = 0; i < numLevels; i++){levels[i] = std::sqrt(levels[i]);}
+    }
+
+    for(int b = 0; b < bands.numBands; b++)
+    {
+        group.gainStep[b] = (Vec::fromRawArray(levels + b * streamsPerVec) * scale - group.gain[b]) * rate;
+    }
+}
+
+
+template <bool sharedCarrier, bool rms, bool cascaded>
+void BatchVocoder::processBands(Group& group, int start, int numSamples)
+{
+    int const numBands = bands.numBands;
+    int const sections = cascaded ? bands.numSections : 1;
+
+    //The last section runs in the band loop below, the ones before it in whole passes over y and cy
+    int const last = 5 * (sections - 1);
+    auto const* b0 = coefficients[static_cast<size_t>(last)].data();
+    auto const* b1 = coefficients[static_cast<size_t>(last + 1)].data();
+    auto const* b2 = coefficients[static_cast<size_t>(last + 2)].data();
+    auto const* a1 = coefficients[static_cast<size_t>(last + 3)].data();
+    auto const* a2 = coefficients[static_cast<size_t>(last + 4)].data();
+    auto* modState1 = group.modState[static_cast<size_t>(2 * sections - 2)].data();
+    auto* modState2 = group.modState[static_cast<size_t>(2 * sections - 1)].data();
+    auto* carState1 = group.carState[static_cast<size_t>(2 * sections - 2)].data();
+    auto* carState2 = group.carState[static_cast<size_t>(2 * sections - 1)].data();
+
+    BandArray y, cy;
+
+    //Bands innermost, as in FilterBank: their recursions are independent, so they overlap in the pipeline
+    for(int i = start; i < start + numSamples; i++)
+    {
+        auto const x = modLanes[i];
+        auto const cx = sharedCarrier ? Vec::expand(0.f) : carLanes[i];
+        auto out = Vec::expand(0.f);
+
+        if (cascaded)
+        {
+            std::fill(y.begin(), y.begin() + numBands, x);
+            for(int s = 0; s < sections - 1; s++){filter(y.data(), group.modState, s);}
+
+            if (! sharedCarrier)
+            {
+                std::fill(cy.begin(), cy.begin() + numBands, cx);
+                for(int s = 0; s < sections - 1; s++){filter(cy.data(), group.carState, s);}
+            }
+        }
+
+        for(int b = 0; b < numBands; b++)
+        {
+            auto const in  = cascaded ? y[b] : x;
+            auto const mod = b0[b] * in + modState1[b];
+            modState1[b] = b1[b] * in - a1[b] * mod + modState2[b];
+            modState2[b] = b2[b] * in - a2[b] * mod;
+
+            auto const delta = (rms ? mod * mod : abs(mod)) - group.envelope[b];
+            group.envelope[b] += delta * envelopeMean + abs(delta) * envelopeHalfDiff;
+
+            group.gain[b] += group.gainStep[b];
+
+            if (sharedCarrier)
+            {
+                out += Vec::expand(carrierBands[b][i]) * group.gain[b];
+            }
+            else
+            {
+                auto const carIn = cascaded ? cy[b] : cx;
+                auto const car   = b0[b] * carIn + carState1[b];
+                carState1[b] = b1[b] * carIn - a1[b] * car + carState2[b];
+                carState2[b] = b2[b] * carIn - a2[b] * car;
+                out += car * group.gain[b];
+            }
+        }
+
+        outLanes[i] = out;
+    }
+}
+
+
+void BatchVocoder::filter(Vec* y, BandStates& states, int s) const
+{
+    auto const* b0 = coefficients[static_cast<size_t>(5 * s)].data();
+    auto const* b1 = coefficients[static_cast<size_t>(5 * s + 1)].data();
+    auto const* b2 = coefficients[static_cast<size_t>(5 * s + 2)].data();
+    auto const* a1 = coefficients[static_cast<size_t>(5 * s + 3)].data();
+    auto const* a2 = coefficients[static_cast<size_t>(5 * s + 4)].data();
+    auto* s1       = states[static_cast<size_t>(2 * s)].data();
+    auto* s2       = states[static_cast<size_t>(2 * s + 1)].data();
+
+    for(int b = 0; b < bands.numBands; b++)
+    {
+        auto const x = y[b];
+        y[b]  = b0[b] * x + s1[b];
+        s1[b] = b1[b] * x - a1[b] * y[b] + s2[b];
+        s2[b] = b2[b] * x - a2[b] * y[b];
+    }
+}
+
+
+void BatchVocoder::settle(Group& group)
+{
+    if (group.idle){return;}
+
+    //The rms detector keeps squared levels
+    auto const limit         = FilterBank::silenceLevel;
+    auto const envelopeLimit = detector == FilterBank::Detector::rms ? limit * limit : limit;
+
+    for(int b = 0; b < bands.numBands; b++)
+    {
+        if (! isBelow(group.gain[b], limit) || ! isBelow(group.envelope[b], envelopeLimit)){return;}
+
+        for(int i = 0; i < 2 * bands.numSections; i++)
+        {
+            if (! isBelow(group.modState[i][b], limit) || ! isBelow(group.carState[i][b], limit)){return;}
+        }
+    }
+
+    clearBands(group, 0);
+    group.idle = true;
+}
+
+
+void BatchVocoder::clearBands(Group& group, int firstBand, int firstSection)
+{
+    auto const zero = Vec::expand(0.f);
+
+    for(auto* state : {&group.modState, &group.carState})
+    {
+        for(int i = 2 * firstSection; i < 2 * maxSections; i++)
+        {
+            for(int b = firstBand; b < maxBands; b++){(*state)[i][b] = zero;}
+        }
+    }
+
+    if (firstSection > 0){return;}
+
+    for(auto* state : {&group.envelope, &group.gain, &group.gainStep})
+    {
+        for(int b = firstBand; b < maxBands; b++){(*state)[b] = zero;}
+    }
+}
+
+
+void BatchVocoder::clearLane(Group& group, int lane)
+{
+    for(auto* state : {&group.modState, &group.carState})
+    {
+        for(auto& slot : *state)
+        {
+            for(auto& band : slot){band.set(static_cast<size_t>(lane), 0.f);}
+        }
+    }
+
+    for(auto* state : {&group.envelope, &group.gain, &group.gainStep})
+    {
+        for(auto& band : *state){band.set(static_cast<size_t>(lane), 0.f);}
+    }
+}
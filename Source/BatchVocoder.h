@@ -0,0 +1,159 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "VocoderEngine.h"
+
+//==============================================================================
+/**
+    The filter-bank vocoder for many independent mono streams with the same settings,
+    e.g. one per connection of a voice-effects server, processed in lockstep.
+
+    FilterBank puts neighbouring bands of one signal into the lanes of a SIMD register;
+    here every lane holds a different stream instead, so each band of a whole group of
+    streams is one filter running on registers, with its coefficients broadcast from
+    the one design all streams share. Throughput per core grows with the SIMD width
+    rather than with the number of bands. Cascaded bands run section by section across
+    all bands, as in FilterBank.
+
+    With the oscillator carrier all streams hear the same carrier, so its bands are
+    filtered once per block and only the analysis and the mix run per stream. Streams
+    can also bring carriers of their own, which then run through per-lane filters too.
+
+    All state sits in groups of streamsPerVec streams that are allocated by prepare(),
+    so process() takes plain arrays of stream pointers and never touches the heap.
+    Groups whose streams are silent and have died away are skipped, as in FilterBank.
+
+    Only the filter-bank mode is offered: mode, carrier, switchCarrMod, linkedAnalysis,
+    multiCore and sharedAnalysis in VocoderParameters are ignored.
+*/
+class BatchVocoder : public SIMDAligned
+{
+
+public:
+
+    using Vec = FilterBank::Vec;
+
+    int constexpr static streamsPerVec = static_cast<int>(Vec::SIMDNumElements);
+    int constexpr static maxBands      = FilterBank::maxBands;
+    int constexpr static maxSections   = BandCascade::maxSections;
+
+    /** Blocks are processed in pieces of this many samples, as in VocoderEngine. */
+    int constexpr static blockSize = VocoderEngine::subBlockSize;
+
+
+    /** Allocates the state of maxStreams streams, resets them all and switches to the
+        given layout. Not realtime safe. */
+    void prepare(double sampleRate, int maxStreams, BandLayout layout);
+
+    /** Switches every stream to a new layout at once, without a ramp; meant for settings
+        that are fixed per session. layout.sampleRate is ignored. Call between process()
+        calls, never from the audio thread. */
+    void setBandLayout(BandLayout layout);
+
+    void reset();
+
+    /** Returns one stream to silence without touching the others, e.g. before its slot
+        is handed to a new connection. Call between process() calls. */
+    void resetStream(int stream);
+
+    int getMaxStreams() const      { return maxStreams; }
+    double getSampleRate() const   { return sampleRate; }
+    int getNumActiveBands() const  { return bands.numBands; }
+
+
+    /** Vocodes streams [0, numStreams) with the shared oscillator as their carrier.
+        modulators and outputs hold one mono buffer of numSamples per stream; an output
+        may alias its own modulator. Streams from numStreams up are left as they are. */
+    void process(float const* const* modulators, float* const* outputs, int numStreams,
+                 int numSamples, VocoderParameters const& parameters);
+
+    /** As above, but every stream brings its own carrier in carriers. */
+    void process(float const* const* modulators, float const* const* carriers, float* const* outputs,
+                 int numStreams, int numSamples, VocoderParameters const& parameters);
+
+
+private:
+
+    using BandArray = std::array<Vec, maxBands>;
+
+    //s1 and s2 of the first section, then of the second, and so on
+    using BandStates = std::array<BandArray, 2 * maxSections>;
+
+    //Everything one group of streams keeps between blocks, one register per band
+    struct Group : public SIMDAligned
+    {
+        BandStates modState, carState;
+        BandArray envelope;
+        BandArray gain, gainStep;
+
+        //Whether all of the above has been flushed to zero after the streams fell silent
+        bool idle{true};
+    };
+
+    double sampleRate{44100.0};
+    int maxStreams{};
+
+    BandSet bands;
+    DesignCache::Entry::Ptr design;
+
+    //The shared coefficients, each broadcast to every lane: b0, b1, b2, a1, a2 of the first
+    //section, then of the second, and so on
+    std::array<BandArray, 5 * maxSections> coefficients;
+
+    std::unique_ptr<Group[]> groups;
+    int numGroups{};
+
+    FilterBank::Detector detector{FilterBank::Detector::rms};
+    Vec envelopeMean{Vec::expand(1.f)};
+    Vec envelopeHalfDiff{Vec::expand(0.f)};
+    int untilGainUpdate{};
+
+    //The shared carrier and its bands for the current block; its filters run once for every stream
+    Oscillator osc_;
+    std::array<float, blockSize> oscOutput;
+    std::array<std::array<float, blockSize>, maxBands> carrierBands;
+    std::array<std::array<float, 2 * maxSections>, maxBands> carrierStates;
+
+    //One group's input and output for the current block, sample by sample with one stream per lane
+    std::array<Vec, blockSize> modLanes, carLanes, outLanes;
+
+
+    void processBlock(float const* const* modulators, float const* const* carriers, float* const* outputs,
+                      int numStreams, int start, int numSamples, VocoderParameters const& parameters);
+
+    void renderCarrier(int numSamples, VocoderParameters const& parameters);
+
+    void processGroup(Group& group, int firstStream, int numLanes, float const* const* modulators,
+                      float const* const* carriers, float* const* outputs, int start, int numSamples,
+                      VocoderParameters const& parameters);
+
+    void updateGainTargets(Group& group, float modGain);
+
+    /** Runs every band of a group over [start, start + numSamples) and writes the sum of
+        the carrier bands weighted by their gains into outLanes. */
+    template <bool sharedCarrier, bool rms, bool cascaded>
+    void processBands(Group& group, int start, int numSamples);
+
+    /** Runs section s of every active band over its own input in y, in place. */
+    void filter(Vec* y, BandStates& states, int s) const;
+
+    /** After a silent block, flushes a group to exact zeros once everything in it is
+        below FilterBank::silenceLevel, so its streams are skipped until they sound again. */
+    void settle(Group& group);
+
+    static void clearBands(Group& group, int firstBand, int firstSection = 0);
+    static void clearLane(Group& group, int lane);
+
+    static Vec abs(Vec v)
+    {
+        return Vec::max(v, Vec::expand(0.f) - v);
+    }
+
+    static bool isBelow(Vec v, float limit)
+    {
+        auto const magnitude = abs(v);
+        for(size_t lane = 0; lane < Vec::SIMDNumElements; lane++){if (magnitude.get(lane) > limit){return false;}}
+        return true;
+    }
+
+};
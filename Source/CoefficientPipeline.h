@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterBank.h"
+
+//==============================================================================
+/**
+    Hands filter-bank designs from the thread that computes them to the audio thread.
+
+    Three preallocated designs are rotated: the writer fills its private slot and swaps
+    it with the shared one, the audio thread swaps the shared slot with the one it is
+    reading from. Neither side ever waits for the other or allocates, and the audio
+    thread always sees either the previous design or a complete new one.
+*/
+class CoefficientPipeline
+{
+
+public:
+
+    /** Copies a finished design and makes it the latest published one. Safe to call from
+        any non-audio thread; concurrent writers are serialised. */
+    void publish(FilterBankDesign const& design)
+    {
+        const juce::SpinLock::ScopedLockType lock(writerLock);
+
+        slots[writeIndex] = design;
+        writeIndex = shared.exchange(writeIndex | freshFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+
+    /** Audio thread only. Returns the newest design if one was published since the last
+        call, otherwise nullptr. The pointer stays valid until the next call. */
+    FilterBankDesign const* acquire() noexcept
+    {
+        if ((shared.load(std::memory_order_relaxed) & freshFlag) == 0){return nullptr;}
+
+        readIndex = shared.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return &slots[readIndex];
+    }
+
+
+private:
+
+    int constexpr static freshFlag = 4;
+    int constexpr static indexMask = 3;
+
+    std::array<FilterBankDesign, 3> slots;
+
+    int writeIndex{0};
+    int readIndex{1};
+    std::atomic<int> shared{2};
+
+    juce::SpinLock writerLock;
+
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterBank.h"
+#include "RealtimeCheck.h"
+
+//==============================================================================
+/**
+    Process-wide cache of finished filter-bank designs, keyed by the whole BandLayout
+    including the sample rate.
+
+    A design never changes once made and is shared by reference count, so any number
+    of instances with the same settings hold one copy between them and only the first
+    one to ask designs it. Entries nobody else holds any more are dropped the next time
+    a new design is added, so the cache never outgrows what is in use.
+*/
+class DesignCache
+{
+
+public:
+
+    class Entry : public juce::ReferenceCountedObject
+    {
+
+    public:
+
+        using Ptr = juce::ReferenceCountedObjectPtr<Entry>;
+
+        explicit Entry(BandLayout const& layoutToDesign)
+        : layout(layoutToDesign)
+        {
+            design.compute(layout);
+        }
+
+        BandLayout const& getLayout() const         { return layout; }
+        FilterBankDesign const& getDesign() const   { return design; }
+
+    private:
+
+        BandLayout const layout;
+        FilterBankDesign design;
+
+        JUCE_DECLARE_NON_COPYABLE(Entry)
+    };
+
+
+    /** The shared design of a layout, made now if no entry has it. Safe to call from any
+        thread except the audio thread; concurrent callers are serialised. */
+    static Entry::Ptr get(BandLayout const& layout)
+    {
+        RealtimeCheck::assertNotRealtime("DesignCache::get");
+
+        auto& cache = getInstance();
+        const juce::ScopedLock lock(cache.lock);
+
+        for (auto* entry : cache.entries)
+        {
+            if (isSameLayout(entry->getLayout(), layout)){return entry;}
+        }
+
+        //Only the cache refers to these, so nobody can ask for them without designing again anyway
+        for (int i = cache.entries.size(); --i >= 0;)
+        {
+            if (cache.entries.getObjectPointerUnchecked(i)->getReferenceCount() == 1){cache.entries.remove(i);}
+        }
+
+        Entry::Ptr entry (new Entry(layout));
+        cache.entries.add(entry);
+        return entry;
+    }
+
+
+    /** Exact comparison: a layout that differs in any bit designs different filters. */
+    static bool isSameLayout(BandLayout const& a, BandLayout const& b)
+    {
+        return a.sampleRate == b.sampleRate && a.numBands == b.numBands && a.lowFreq == b.lowFreq
+            && a.highFreq == b.highFreq && a.q == b.q && a.wide == b.wide
+            && a.numSections == b.numSections && a.spectralBands == b.spectralBands;
+    }
+
+
+private:
+
+    juce::CriticalSection lock;
+    juce::ReferenceCountedArray<Entry> entries;
+
+
+    static DesignCache& getInstance()
+    {
+        static DesignCache cache;
+        return cache;
+    }
+
+
+};
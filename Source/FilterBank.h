@@ -0,0 +1,1118 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+#include "SIMDAligned.h"
+
+//==============================================================================
+/** Normalised biquad coefficients (a0 == 1), transposed direct form II. */
+struct BandCoefficients
+{
+    float b0{}, b1{}, b2{}, a1{}, a2{};
+
+    /** Same design as juce::dsp::IIR::Coefficients::makeBandPass, without the heap object. */
+    static BandCoefficients makeBandPass(double sampleRate, float frequency, float q)
+    {
+        return makeBandPass(std::tan(double_Pi * frequency / sampleRate), static_cast<double>(q));
+    }
+
+
+    /** As above, with the centre given on the prewarped axis of the bilinear transform,
+        i.e. as tan(pi * frequency / sampleRate). */
+    static BandCoefficients makeBandPass(double warpedFrequency, double q)
+    {
+        auto const n        = 1.0 / warpedFrequency;
+        auto const nSquared = n * n;
+        auto const invQ     = 1.0 / q;
+        auto const c1       = 1.0 / (1.0 + invQ * n + nSquared);
+
+        BandCoefficients c;
+        c.b0 = static_cast<float>(c1 * n * invQ);
+        c.b1 = 0.f;
+        c.b2 = static_cast<float>(-c1 * n * invQ);
+        c.a1 = static_cast<float>(c1 * 2.0 * (1.0 - nSquared));
+        c.a2 = static_cast<float>(c1 * (1.0 - invQ * n + nSquared));
+        return c;
+    }
+};
+
+
+//==============================================================================
+/** A band-pass of order 2 * numSections, as biquads run in series. */
+struct BandCascade
+{
+    int constexpr static maxSections = 4;
+
+    //Sections past the design's count pass the signal unchanged; a default cascade is silent
+    std::array<BandCoefficients, maxSections> sections;
+
+
+    /** Butterworth band-pass with the centre and -3 dB bandwidth of
+        BandCoefficients::makeBandPass(sampleRate, frequency, q) and unity gain at the centre,
+        so more sections only make the skirts steeper. One section is exactly that biquad. */
+    static BandCascade makeBandPass(double sampleRate, float frequency, float q, int numSections)
+    {
+        numSections = juce::jlimit(1, maxSections, numSections);
+
+        auto const warpedCentre = std::tan(double_Pi * frequency / sampleRate);
+
+        //Unused sections cancel their poles with equal zeros, taken from the longest cascade:
+        //a ramp towards a longer one then keeps its poles nearly in place instead of leaking
+        //the flat response of a plain pass-through through the growing resonance
+        std::array<Section, maxSections> designs;
+        designSections(warpedCentre, q, maxSections, designs);
+
+        BandCascade cascade;
+
+        for(int s = 0; s < maxSections; s++)
+        {
+            auto const d = BandCoefficients::makeBandPass(designs[static_cast<size_t>(s)].warpedFrequency, designs[static_cast<size_t>(s)].q);
+            cascade.sections[static_cast<size_t>(s)] = {1.f, d.a1, d.a2, d.a1, d.a2};
+        }
+
+        if (numSections == 1)
+        {
+            cascade.sections[0] = BandCoefficients::makeBandPass(sampleRate, frequency, q);
+            return cascade;
+        }
+
+        designSections(warpedCentre, q, numSections, designs);
+
+        //Each section peaks at its own centre and is lifted to unity gain at the band's, so a
+        //ramp from a single biquad or a shorter cascade keeps the centre gain near 1 throughout
+        for(int s = 0; s < numSections; s++)
+        {
+            auto& c          = cascade.sections[static_cast<size_t>(s)];
+            auto const& d    = designs[static_cast<size_t>(s)];
+            auto const scale = 1.0 / d.centreGain;
+
+            c    = BandCoefficients::makeBandPass(d.warpedFrequency, d.q);
+            c.b0 = static_cast<float>(c.b0 * scale);
+            c.b1 = static_cast<float>(c.b1 * scale);
+            c.b2 = static_cast<float>(c.b2 * scale);
+        }
+
+        return cascade;
+    }
+
+
+    /** A section's centre on the prewarped axis of the bilinear transform, its quality, and
+        its gain at the centre of the whole band. */
+    struct Section
+    {
+        double warpedFrequency, q, centreGain;
+    };
+
+    /** Splits the analog Butterworth band-pass of order 2 * numSections around warpedCentre
+        into numSections unity-peak band-pass sections. */
+    static void designSections(double warpedCentre, double q, int numSections, std::array<Section, maxSections>& sections)
+    {
+        auto const bandwidth = warpedCentre / q;
+        auto const centre    = std::complex<double>(0.0, warpedCentre);
+        int count            = 0;
+
+        auto const add = [&] (double frequency, double sectionQ)
+        {
+            //(w / q) s / (s^2 + (w / q) s + w^2), the analog form of BandCoefficients::makeBandPass
+            auto const damping = frequency / sectionQ;
+            auto const gain    = std::abs(damping * centre / (centre * centre + damping * centre + frequency * frequency));
+            sections[static_cast<size_t>(count++)] = {frequency, sectionQ, gain};
+        };
+
+        //Low-pass prototype poles on the left half of the unit circle; the conjugates of the
+        //upper ones give the same sections, and a real pole maps to the plain biquad
+        for(int k = 0; k < numSections; k++)
+        {
+            auto const pole = std::polar(1.0, double_Pi * (2 * k + numSections + 1) / (2 * numSections));
+
+            if (pole.imag() < -1.0e-9){continue;}
+
+            if (pole.imag() <= 1.0e-9)
+            {
+                add(warpedCentre, q);
+                continue;
+            }
+
+            //s -> (s^2 + centre^2) / (bandwidth s) turns each pole into the roots of s^2 - p B s + centre^2
+            auto const pb   = pole * bandwidth;
+            auto const root = std::sqrt(pb * pb - 4.0 * warpedCentre * warpedCentre);
+
+            for(auto const r : {0.5 * (pb + root), 0.5 * (pb - root)}){add(std::abs(r), std::abs(r) / (-2.0 * r.real()));}
+        }
+
+        jassert(count == numSections);
+    }
+};
+
+
+//==============================================================================
+/** Parameters that fully determine the band-pass designs of the bank. */
+struct BandLayout
+{
+    double sampleRate{44100};
+    int   numBands{12};
+    float lowFreq{100.f};
+    float highFreq{20000.f};
+    float q{5.f};
+    float wide{1.5f};
+
+    /** Biquads in series per band, for band-pass filters of order 2, 4, 6 or 8. */
+    int   numSections{1};
+
+    /** Bands of the spectral mode, spaced evenly on a log axis from lowFreq to highFreq. */
+    int   spectralBands{128};
+};
+
+
+//==============================================================================
+/** Coefficients for a bank of bands, of which the first numBands are active and run
+    their first numSections sections. */
+struct BandSet
+{
+    int constexpr static maxBands = 48;
+
+    int numBands{};
+    int numSections{1};
+    std::array<BandCascade, maxBands> bands;
+};
+
+
+//==============================================================================
+/** Coefficients for every band of the bank, computed without touching the heap. */
+struct FilterBankDesign : public BandSet
+{
+    int constexpr static maxSpectralBands = 512;
+    int constexpr static maxTiers = 5;
+
+    //The same bands split into octave tiers for the multirate bank: tier t runs at
+    //sampleRate / 2^t and holds the bands whose upper edge fits below tierPassband of that rate
+    int numTiers{1};
+    std::array<BandSet, maxTiers> tiers;
+
+    /** Highest band edge, relative to the tier rate, that a tier accepts. It leaves room
+        below the decimators' passband for the skirts of the band-pass filters. */
+    float constexpr static tierPassband = 0.3f;
+
+    //Band edges in Hz for the spectral mode; band i spans [spectralEdges[i], spectralEdges[i + 1])
+    int numSpectralBands{};
+    std::array<float, maxSpectralBands + 1> spectralEdges;
+
+
+    void compute(BandLayout const& layout)
+    {
+        float const freqStep   = layout.highFreq / static_cast<float>(layout.numBands);
+        float const freqFactor = layout.highFreq / (layout.highFreq - freqStep) * layout.wide;
+        float const maxFreq    = juce::jmin(layout.highFreq, 0.49f * static_cast<float>(layout.sampleRate));
+        float frequency        = layout.lowFreq;
+
+        //Band frequencies only ever grow, so the active bands always form a prefix of the bank
+        numBands = 0;
+
+        //...and each tier gets a contiguous run of them, the lowest bands going to the deepest tier
+        numTiers = getNumTiers(layout.sampleRate);
+        for(auto& tier : tiers){tier = {};}
+
+        numSections = juce::jlimit(1, BandCascade::maxSections, layout.numSections);
+        for(auto& tier : tiers){tier.numSections = numSections;}
+
+        for(int i = 0; i < maxBands; i++)
+        {
+            if (i < layout.numBands && frequency < maxFreq)
+            {
+                bands[i] = BandCascade::makeBandPass(layout.sampleRate, frequency, layout.q, numSections);
+                numBands++;
+
+                int t = numTiers - 1;
+                while (t > 0 && frequency * (1.f + 2.f / layout.q) > tierPassband * static_cast<float>(layout.sampleRate) / static_cast<float>(1 << t)){t--;}
+
+                auto& tier = tiers[t];
+                tier.bands[tier.numBands++] = BandCascade::makeBandPass(layout.sampleRate / (1 << t), frequency, layout.q, numSections);
+            }
+            else
+            {
+                bands[i] = {};
+            }
+
+            frequency *= freqFactor;
+        }
+
+        numSpectralBands = juce::jlimit(1, maxSpectralBands, layout.spectralBands);
+        float const lowEdge  = juce::jmin(layout.lowFreq, layout.highFreq);
+        float const highEdge = juce::jmax(layout.lowFreq, layout.highFreq);
+        float const ratio    = std::pow(highEdge / lowEdge, 1.f / static_cast<float>(numSpectralBands));
+
+        spectralEdges[0] = lowEdge;
+
+        for(int i = 1; i <= numSpectralBands; i++){spectralEdges[i] = spectralEdges[i - 1] * ratio;}
+    }
+
+
+    /** Octave tiers used at a sample rate: halving stops before the rate drops below 11 kHz. */
+    static int getNumTiers(double sampleRate)
+    {
+        int tiers = 1;
+        while (tiers < maxTiers && sampleRate / (1 << tiers) >= 11000.0){tiers++;}
+        return tiers;
+    }
+};
+
+
+//==============================================================================
+/** The level of every band at each gain update of one block of a FilterBank's analysis,
+    before modGain, so another bank fed the same modulator can replay it. */
+struct AnalysisFrame
+{
+    //Enough for a block of 256 samples, whatever its offset from the update grid
+    int constexpr static maxUpdates = 17;
+
+    int numUpdates{};
+    std::array<std::array<float, FilterBankDesign::maxBands>, maxUpdates> levels;
+};
+
+
+//==============================================================================
+/**
+    Bank of band-pass biquads stored as structure-of-arrays, so that one SIMD
+    register holds the same coefficient (or state) of several neighbouring bands.
+    Steeper bands run numSections biquads in series. Every section is stored like the
+    first, one array per coefficient across all groups, and runs across all groups before
+    the next one, so the recursions of different groups overlap in the pipeline.
+
+    Modulator and carrier share one set of coefficients. process() walks the block
+    exactly once: for every sample it filters the modulator through all bands, updates
+    each band's envelope follower, and adds the carrier bands weighted by those
+    envelopes into the output. Band gains are refreshed on a fixed grid of
+    controlInterval samples that carries over between calls, so the result does not
+    depend on how the host splits the signal into blocks.
+
+    Partitions whose band gains are below silenceLevel skip their carrier filters and
+    restart them from rest when they come back. Once silent input has let everything
+    die away, whole blocks cost only a scan of the modulator.
+
+    The analysis can also be recorded into an AnalysisFrame and replayed by follow() on
+    another bank, which then only runs its carrier filters; see SharedAnalysis.
+*/
+class FilterBank : public SIMDAligned
+{
+
+public:
+
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    int constexpr static maxBands        = FilterBankDesign::maxBands;
+    //Enough for 7.1.4 and third-order ambisonics
+    int constexpr static maxChannels     = 16;
+    int constexpr static bandsPerVec     = static_cast<int>(Vec::SIMDNumElements);
+    int constexpr static maxGroups       = (maxBands + bandsPerVec - 1) / bandsPerVec;
+    int constexpr static controlInterval = 16;
+    int constexpr static maxSections     = BandCascade::maxSections;
+
+    //Active bands are rounded up to whole buckets, so the kernels only come in a few sizes;
+    //the extra bands have all-zero coefficients and add exact zeros
+    int constexpr static bandsPerBucket  = bandsPerVec > 8 ? bandsPerVec : 8;
+    int constexpr static groupsPerBucket = bandsPerBucket / bandsPerVec;
+    int constexpr static maxBuckets      = maxBands / bandsPerBucket;
+
+    static_assert(maxBands % bandsPerBucket == 0, "The bank must hold whole buckets");
+
+    //Bands and blocks below this level count as silent; it is -100 dB, well under any dither
+    float constexpr static silenceLevel = 1.0e-5f;
+
+    enum class Detector { rms, peak };
+
+
+    FilterBank()
+    {
+        for(int i = 0; i < maxBands; i++){setBand(i, {});}
+        reset();
+    }
+
+
+    void reset()
+    {
+        auto const zero = Vec::expand(0.f);
+
+        for(int channel = 0; channel < maxChannels; channel++)
+        {
+            for(auto& slot : modState[channel]){slot.fill(zero);}
+            for(auto& slot : carState[channel]){slot.fill(zero);}
+            envelope[channel].fill(zero);
+        }
+
+        gain.fill(zero);
+        gainStep.fill(zero);
+        untilGainUpdate = 0;
+
+        carrierActive.fill(false);
+        idle.fill(true);
+        wasFollowing = false;
+    }
+
+
+    /** Attack and release are the times to cover ~63% of a step, in milliseconds. */
+    void setEnvelope(double sampleRate, float attackMs, float releaseMs, Detector newDetector)
+    {
+        auto const coefficient = [sampleRate](float ms)
+        {
+            return static_cast<float>(1.0 - std::exp(-1000.0 / (juce::jmax(0.01f, ms) * sampleRate)));
+        };
+
+        auto const attack  = coefficient(attackMs);
+        auto const release = coefficient(releaseMs);
+
+        //attack * d for rising input and release * d for falling input, without a branch:
+        //d * (attack + release) / 2 + |d| * (attack - release) / 2
+        envelopeMean = Vec::expand(0.5f * (attack + release));
+        envelopeHalfDiff = Vec::expand(0.5f * (attack - release));
+        detector = newDetector;
+    }
+
+
+    /** Bands from the bucket above numBands upwards are skipped entirely by the processing loops. */
+    void setNumBands(int n)
+    {
+        jassert(n >= 0 && n <= maxBands);
+        numBands  = n;
+        numGroups = (n + bandsPerBucket - 1) / bandsPerBucket * groupsPerBucket;
+    }
+
+    int getNumBands() const { return numBands; }
+
+
+    /** Current gain applied to a carrier band, i.e. the modulator level times modGain. */
+    float getBandGain(int band) const
+    {
+        return gain[static_cast<size_t>(band / bandsPerVec)].get(static_cast<size_t>(band % bandsPerVec));
+    }
+
+    bool isRamping() const { return ramping; }
+
+    int getNumSections() const { return numSections; }
+
+
+    void setBand(int band, BandCascade const& cascade)
+    {
+        auto const g    = static_cast<size_t>(band / bandsPerVec);
+        auto const lane = static_cast<size_t>(band % bandsPerVec);
+
+        for(int s = 0; s < maxSections; s++)
+        {
+            auto const& c = cascade.sections[static_cast<size_t>(s)];
+            auto* section = coefficients.data() + s * coefficientsPerSection;
+
+            section[0][g].set(lane, c.b0);
+            section[1][g].set(lane, c.b1);
+            section[2][g].set(lane, c.b2);
+            section[3][g].set(lane, c.a1);
+            section[4][g].set(lane, c.a2);
+        }
+    }
+
+
+    /** Switches to a new design immediately, e.g. while playback is stopped. */
+    void setDesign(BandSet const& design)
+    {
+        for(int i = 0; i < maxBands; i++){setBand(i, design.bands[i]);}
+        setNumBands(design.numBands);
+        setNumSections(design.numSections);
+        ramping = false;
+    }
+
+
+    /** Moves every coefficient linearly from the current design to the new one over the next
+        numSamples processed samples, then lands exactly on it. */
+    void beginRamp(BandSet const& design, int numSamples)
+    {
+        if (numSamples <= 0){setDesign(design); return;}
+
+        auto const scale = Vec::expand(1.f / static_cast<float>(numSamples));
+
+        target = coefficients;
+
+        for(int i = 0; i < maxBands; i++){setBand(i, design.bands[i]);}
+
+        //Biquads with a1/a2 inside the stability triangle stay stable along a straight line
+        //between two such designs, so every intermediate filter is well behaved; sections
+        //beyond the shorter cascade pass the signal unchanged at that end of the ramp
+        for(int c = 0; c < numCoefficients; c++)
+        {
+            auto& current = coefficients[c];
+
+            for(int g = 0; g < maxGroups; g++)
+            {
+                auto const start = target[c][g];
+                target[c][g]     = current[g];
+                step[c][g]       = (current[g] - start) * scale;
+                current[g]       = start;
+            }
+        }
+
+        setNumBands(juce::jmax(numBands, design.numBands));
+        setNumSections(juce::jmax(numSections, design.numSections));
+        rampBands     = design.numBands;
+        rampSections  = design.numSections;
+        rampRemaining = numSamples;
+        ramping       = true;
+    }
+
+
+    /** Runs modulator analysis and carrier synthesis for one block.
+
+        modulator has numModChannels channels whose envelopes are averaged per band;
+        carrier and output have numCarChannels channels. Each sample of the modulator is
+        read before the same sample of the output is written, so the output may alias
+        either input. modGain scales every band gain.
+    */
+    void process(float const* const* modulator, int numModChannels,
+                 float const* const* carrier, float* const* output, int numCarChannels,
+                 int numSamples, float modGain)
+    {
+        processPartitions(0, getNumPartitions(), modulator, numModChannels, carrier, output, numCarChannels, numSamples, modGain);
+        endBlock(numSamples);
+    }
+
+
+    /** As above, and also records the analysis into frame for follow(). frame.numUpdates is
+        -1 if the block was skipped as silent or needed more updates than the frame holds. */
+    void process(float const* const* modulator, int numModChannels,
+                 float const* const* carrier, float* const* output, int numCarChannels,
+                 int numSamples, float modGain, AnalysisFrame& frame)
+    {
+        frame.numUpdates = 0;
+        recording = &frame;
+        process(modulator, numModChannels, carrier, output, numCarChannels, numSamples, modGain);
+        recording = nullptr;
+    }
+
+
+    /** As process(), but the band levels are replayed from a frame another bank recorded
+        for a block with the same getAnalysisKey(); the modulator is only scanned for silence.
+        The envelopes follow the replayed levels, so analysing again later carries on smoothly. */
+    void follow(AnalysisFrame const& frame, float const* const* modulator, int numModChannels,
+                float const* const* carrier, float* const* output, int numCarChannels,
+                int numSamples, float modGain)
+    {
+        //Filter states left from before would ring out into the envelopes once analysis resumes
+        if (! wasFollowing)
+        {
+            for(int p = 0; p < maxPartitions; p++){clearPartition(modState, p);}
+            wasFollowing = true;
+        }
+
+        following = &frame;
+        process(modulator, numModChannels, carrier, output, numCarChannels, numSamples, modGain);
+        following = nullptr;
+    }
+
+
+    /** Hash of the modulator samples of the next block together with everything else its
+        levels depend on: the coefficients, the envelope settings, the channel count and where
+        the block falls on the gain update grid. Banks with equal keys compute equal levels. */
+    uint64_t getAnalysisKey(float const* const* modulator, int numModChannels, int numSamples) const
+    {
+        //FNV-1a over 32-bit words
+        uint64_t hash = 14695981039346656037ull;
+
+        auto const add = [&hash] (void const* data, size_t numBytes)
+        {
+            auto const* bytes = static_cast<char const*>(data);
+
+            for(size_t i = 0; i + sizeof(uint32_t) <= numBytes; i += sizeof(uint32_t))
+            {
+                uint32_t word;
+                std::memcpy(&word, bytes + i, sizeof(word));
+                hash = (hash ^ word) * 1099511628211ull;
+            }
+        };
+
+        int const settings[] = { numModChannels, numSamples, untilGainUpdate, numGroups, numSections, static_cast<int>(detector) };
+        float const envelopeSettings[] = { envelopeMean.get(0), envelopeHalfDiff.get(0) };
+
+        add(settings, sizeof(settings));
+        add(envelopeSettings, sizeof(envelopeSettings));
+
+        for(auto const& c : coefficients){add(c.data(), sizeof(Vec) * static_cast<size_t>(numGroups));}
+
+        for(int channel = 0; channel < numModChannels; channel++){add(modulator[channel], sizeof(float) * static_cast<size_t>(numSamples));}
+
+        return hash;
+    }
+
+
+    //==============================================================================
+    /** Bands are split into fixed partitions that share no state, so one block can be
+        processed partition by partition on different threads. The carrier bands of each
+        partition are summed on their own and the partition sums are added in order, both
+        by process() and when combining partial outputs, so either way gives identical bits.
+    */
+    int constexpr static bandsPerPartition  = 16;
+    int constexpr static groupsPerPartition = bandsPerPartition / bandsPerVec > 0 ? bandsPerPartition / bandsPerVec : 1;
+    int constexpr static maxPartitions      = (maxGroups + groupsPerPartition - 1) / groupsPerPartition;
+
+    static_assert(groupsPerPartition % groupsPerBucket == 0, "Partitions must hold whole buckets");
+
+    int getNumPartitions() const { return (numGroups + groupsPerPartition - 1) / groupsPerPartition; }
+
+
+    /** Processes partitions [firstPartition, lastPartition) for one block and writes the sum
+        of their carrier bands. Calls for disjoint ranges may run concurrently, but then the
+        output must not alias the inputs. Call endBlock() once every partition is done. */
+    void processPartitions(int firstPartition, int lastPartition,
+                           float const* const* modulator, int numModChannels,
+                           float const* const* carrier, float* const* output, int numCarChannels,
+                           int numSamples, float modGain)
+    {
+        jassert(numModChannels <= maxChannels && numCarChannels <= maxChannels);
+
+        Range range;
+        range.firstGroup = firstPartition * groupsPerPartition;
+        range.lastGroup  = juce::jmax(range.firstGroup, juce::jmin(numGroups, lastPartition * groupsPerPartition));
+
+        //Without active bands in the range there is nothing to filter or record
+        if (range.lastGroup == range.firstGroup)
+        {
+            for(int channel = 0; channel < numCarChannels; channel++){juce::FloatVectorOperations::clear(output[channel], numSamples);}
+            if (recording != nullptr){recording->numUpdates = -1;}
+            return;
+        }
+
+        int const lastActivePartition = (range.lastGroup + groupsPerPartition - 1) / groupsPerPartition;
+        bool const silent = isSilent(modulator, numModChannels, numSamples);
+
+        //Once every band has died away, silent input gives silent output without running the bank.
+        //Idle partitions stay untouched even when others in the range still ring out, so a range
+        //gives the same bits whether it is processed in one call or partition by partition.
+        bool const freeze = silent && ! ramping;
+
+        if (freeze && isIdle(firstPartition, lastActivePartition))
+        {
+            for(int channel = 0; channel < numCarChannels; channel++){juce::FloatVectorOperations::clear(output[channel], numSamples);}
+            if (recording != nullptr){recording->numUpdates = -1;}
+            return;
+        }
+
+        if (following == nullptr){wasFollowing = false;}
+
+        //The loop shape is fixed for the whole block, so the kernels are looked up once here
+        auto const& kernels = getKernels();
+        //A replayed analysis leaves no modulator channels for the kernels to filter
+        int const numAnalysed = following != nullptr ? 0 : numModChannels;
+
+        auto const index    = getKernelIndex((range.lastGroup - range.firstGroup) / groupsPerBucket,
+                                             numSections, detector == Detector::rms);
+        auto const steady   = kernels[index];
+        auto const ramp     = kernels[index + 1];
+        auto const channels = Channels {numAnalysed, numCarChannels};
+
+        //Local copies of the block schedule, so every partition follows the same one
+        int  untilUpdate = untilGainUpdate;
+        int  rampLeft    = rampRemaining;
+        bool isRamping   = ramping;
+        int  position    = 0;
+        int  update      = 0;
+
+        while (position < numSamples)
+        {
+            if (untilUpdate == 0)
+            {
+                updateGainTargets(range, numModChannels, modGain, update++, freeze);
+                untilUpdate = controlInterval;
+            }
+
+            int chunk = juce::jmin(untilUpdate, numSamples - position);
+            if (isRamping){chunk = juce::jmin(chunk, rampLeft);}
+
+            if (isRamping)
+            {
+                (this->*ramp)(range, channels, modulator, carrier, output, position, chunk);
+                rampLeft -= chunk;
+
+                if (rampLeft == 0)
+                {
+                    landRamp(range);
+                    isRamping = false;
+                }
+            }
+            else
+            {
+                (this->*steady)(range, channels, modulator, carrier, output, position, chunk);
+            }
+
+            untilUpdate -= chunk;
+            position    += chunk;
+        }
+
+        if (recording != nullptr){recording->numUpdates = update <= AnalysisFrame::maxUpdates ? update : -1;}
+
+        for(int p = firstPartition; p < lastActivePartition; p++)
+        {
+            if (freeze && idle[static_cast<size_t>(p)]){restoreIdle(p);}
+            else if (silent)                           {settle(p);}
+            else                                       {idle[static_cast<size_t>(p)] = false;}
+        }
+    }
+
+
+    /** Advances the shared block schedule after every partition has processed numSamples. */
+    void endBlock(int numSamples)
+    {
+        if (untilGainUpdate == 0){untilGainUpdate = controlInterval;}
+
+        untilGainUpdate -= numSamples;
+        while (untilGainUpdate < 0){untilGainUpdate += controlInterval;}
+
+        if (ramping)
+        {
+            rampRemaining -= numSamples;
+
+            if (rampRemaining <= 0)
+            {
+                setNumBands(rampBands);
+                setNumSections(rampSections);
+                ramping = false;
+            }
+        }
+    }
+
+
+private:
+
+    //b0, b1, b2, a1, a2 of the first section, then of the second, and so on
+    int constexpr static coefficientsPerSection = 5;
+    int constexpr static numCoefficients        = coefficientsPerSection * maxSections;
+
+    using GroupArray   = std::array<Vec, maxGroups>;
+    using Coefficients = std::array<GroupArray, numCoefficients>;
+    //Per channel, s1 and s2 of the first section, then of the second, and so on
+    using ChannelState = std::array<std::array<GroupArray, 2 * maxSections>, maxChannels>;
+
+    int numBands{};
+    int numGroups{};
+    int numSections{1};
+
+    Coefficients coefficients;
+
+    ChannelState modState, carState;
+    std::array<GroupArray, maxChannels> envelope;
+
+    Detector detector{Detector::rms};
+    Vec envelopeMean{Vec::expand(1.f)};
+    Vec envelopeHalfDiff{Vec::expand(0.f)};
+
+    GroupArray gain, gainStep;
+    int untilGainUpdate{};
+
+    //Per partition: whether its carrier bands are loud enough to run, and whether all of
+    //its state has been flushed to zero after the modulator fell silent
+    std::array<bool, maxPartitions> carrierActive;
+    std::array<bool, maxPartitions> idle;
+
+    //Set for the duration of a recording process() or a follow() call
+    AnalysisFrame* recording{nullptr};
+    AnalysisFrame const* following{nullptr};
+    bool wasFollowing{false};
+
+    bool ramping{false};
+    int  rampBands{};
+    int  rampSections{1};
+    int  rampRemaining{};
+    Coefficients target;
+    Coefficients step;
+
+
+    /** Sections dropped by a shorter cascade restart from rest if a later design brings them back. */
+    void setNumSections(int n)
+    {
+        jassert(n >= 1 && n <= maxSections);
+
+        for(auto* state : {&modState, &carState})
+        {
+            for(auto& channel : *state)
+            {
+                for(int i = 2 * n; i < 2 * numSections; i++){channel[static_cast<size_t>(i)].fill(Vec::expand(0.f));}
+            }
+        }
+
+        numSections = n;
+    }
+
+
+    //Always starts on a partition boundary and spans whole buckets
+    struct Range
+    {
+        int firstGroup, lastGroup;
+    };
+
+    struct Channels
+    {
+        int numMod, numCar;
+    };
+
+
+    void landRamp(Range const& range)
+    {
+        for(int c = 0; c < numCoefficients; c++)
+        {
+            for(int g = range.firstGroup; g < range.lastGroup; g++){coefficients[c][g] = target[c][g];}
+        }
+    }
+
+
+    /** Sets up the linear gain ramp towards the level the envelopes have reached now, or
+        towards the level replayed for this update of the block. With freeze set, idle
+        partitions keep their zero gains and record zero levels. */
+    void updateGainTargets(Range const& range, int numModChannels, float modGain, int update, bool freeze)
+    {
+        auto const scale = Vec::expand(modGain / static_cast<float>(juce::jmax(1, numModChannels)));
+        auto const rate  = Vec::expand(1.f / static_cast<float>(controlInterval));
+
+        for(int g = range.firstGroup; g < range.lastGroup; g++)
+        {
+            auto level = Vec::expand(0.f);
+
+            if (freeze && idle[static_cast<size_t>(g / groupsPerPartition)])
+            {
+                if (recording != nullptr && update < AnalysisFrame::maxUpdates)
+                {
+                    auto& levels = recording->levels[static_cast<size_t>(update)];
+                    for(size_t lane = 0; lane < Vec::SIMDNumElements; lane++){levels[static_cast<size_t>(g * bandsPerVec) + lane] = 0.f;}
+                }
+
+                continue;
+            }
+
+            if (following != nullptr)
+            {
+                auto const& levels = following->levels[static_cast<size_t>(update)];
+                for(size_t lane = 0; lane < Vec::SIMDNumElements; lane++){level.set(lane, levels[static_cast<size_t>(g * bandsPerVec) + lane]);}
+
+                //Every channel gets the average, in the form its detector keeps
+                auto share = level * Vec::expand(1.f / static_cast<float>(juce::jmax(1, numModChannels)));
+                if (detector == Detector::rms){share = share * share;}
+
+                for(int channel = 0; channel < numModChannels; channel++){envelope[channel][g] = share;}
+            }
+            else
+            {
+                for(int channel = 0; channel < numModChannels; channel++)
+                {
+                    auto e = envelope[channel][g];
+
+                    if (detector == Detector::rms)
+                    {
+                        for(size_t lane = 0; lane < Vec::SIMDNumElements; lane++){e.set(lane, std::sqrt(e.get(lane)));}
+                    }
+
+                    level += e;
+                }
+
+                if (recording != nullptr && update < AnalysisFrame::maxUpdates)
+                {
+                    auto& levels = recording->levels[static_cast<size_t>(update)];
+                    for(size_t lane = 0; lane < Vec::SIMDNumElements; lane++){levels[static_cast<size_t>(g * bandsPerVec) + lane] = level.get(lane);}
+                }
+            }
+
+            gainStep[g] = (level * scale - gain[g]) * rate;
+        }
+
+        //Carrier bands too quiet to hear at either end of this interval are skipped until it ends
+        for(int p = range.firstGroup / groupsPerPartition; p * groupsPerPartition < range.lastGroup; p++)
+        {
+            if (freeze && idle[static_cast<size_t>(p)]){continue;}
+
+            int const lastGroup = juce::jmin(range.lastGroup, (p + 1) * groupsPerPartition);
+            bool active = false;
+
+            for(int g = p * groupsPerPartition; g < lastGroup; g++)
+            {
+                auto const peak = Vec::max(abs(gain[g]), abs(gain[g] + gainStep[g] * Vec::expand(static_cast<float>(controlInterval))));
+                for(size_t lane = 0; lane < Vec::SIMDNumElements; lane++){active = active || peak.get(lane) > silenceLevel;}
+            }
+
+            //A skipped filter would hold a stale state, so it restarts from rest instead, under a gain near zero
+            if (carrierActive[static_cast<size_t>(p)] && ! active){clearPartition(carState, p);}
+
+            carrierActive[static_cast<size_t>(p)] = active;
+        }
+    }
+
+
+    static bool isSilent(float const* const* signal, int numChannels, int numSamples)
+    {
+        for(int channel = 0; channel < numChannels; channel++)
+        {
+            auto const range = juce::FloatVectorOperations::findMinAndMax(signal[channel], numSamples);
+            if (range.getStart() < -silenceLevel || range.getEnd() > silenceLevel){return false;}
+        }
+
+        return true;
+    }
+
+
+    bool isIdle(int firstPartition, int lastPartition) const
+    {
+        for(int p = firstPartition; p < lastPartition; p++){if (! idle[static_cast<size_t>(p)]){return false;}}
+        return true;
+    }
+
+
+    /** After a silent block, flushes a partition to exact zeros once everything in it is
+        below silenceLevel, so the fast path can take over without a step on re-entry. */
+    void settle(int p)
+    {
+        if (idle[static_cast<size_t>(p)]){return;}
+
+        //The rms detector keeps squared levels
+        auto const envelopeLimit = detector == Detector::rms ? silenceLevel * silenceLevel : silenceLevel;
+        int const firstGroup = p * groupsPerPartition;
+        int const lastGroup  = juce::jmin(maxGroups, firstGroup + groupsPerPartition);
+
+        for(int g = firstGroup; g < lastGroup; g++)
+        {
+            if (! isBelow(gain[g], silenceLevel)){return;}
+
+            for(int channel = 0; channel < maxChannels; channel++)
+            {
+                if (! isBelow(envelope[channel][g], envelopeLimit)){return;}
+
+                for(int i = 0; i < 2 * numSections; i++)
+                {
+                    if (! isBelow(modState[channel][i][g], silenceLevel) || ! isBelow(carState[channel][i][g], silenceLevel)){return;}
+                }
+            }
+        }
+
+        clearPartition(modState, p);
+        clearPartition(carState, p);
+        clearPartition(envelope, p);
+
+        auto const zero = Vec::expand(0.f);
+        for(int g = firstGroup; g < lastGroup; g++){gain[g] = zero; gainStep[g] = zero;}
+
+        idle[static_cast<size_t>(p)] = true;
+    }
+
+
+    /** Puts an idle partition back to rest after a block that ran it only because others in the
+        same range were still active. Its gains stayed at zero, so it added nothing to the output,
+        but its filters and envelopes may have picked up the near-silent input. */
+    void restoreIdle(int p)
+    {
+        clearPartition(modState, p);
+        clearPartition(carState, p);
+        clearPartition(envelope, p);
+    }
+
+
+    static bool isBelow(Vec v, float limit)
+    {
+        auto const magnitude = abs(v);
+        for(size_t lane = 0; lane < Vec::SIMDNumElements; lane++){if (magnitude.get(lane) > limit){return false;}}
+        return true;
+    }
+
+
+    static void clearPartition(std::array<GroupArray, maxChannels>& state, int p)
+    {
+        int const firstGroup = p * groupsPerPartition;
+        int const lastGroup  = juce::jmin(maxGroups, firstGroup + groupsPerPartition);
+
+        for(auto& channel : state)
+        {
+            for(int g = firstGroup; g < lastGroup; g++){channel[g] = Vec::expand(0.f);}
+        }
+    }
+
+    static void clearPartition(ChannelState& state, int p)
+    {
+        int const firstGroup = p * groupsPerPartition;
+        int const lastGroup  = juce::jmin(maxGroups, firstGroup + groupsPerPartition);
+
+        for(auto& channel : state)
+        {
+            for(auto& slot : channel)
+            {
+                for(int g = firstGroup; g < lastGroup; g++){slot[g] = Vec::expand(0.f);}
+            }
+        }
+    }
+
+
+    static Vec abs(Vec v)
+    {
+        return Vec::max(v, Vec::expand(0.f) - v);
+    }
+
+
+    /** Runs section s of groups [firstGroup, lastGroup) over their inputs in y, in place. */
+    void filter(Vec* y, std::array<GroupArray, 2 * maxSections>& state, int s, int firstGroup, int lastGroup)
+    {
+        auto const* c  = coefficients.data() + s * coefficientsPerSection;
+        auto const* c0 = c[0].data();
+        auto const* c1 = c[1].data();
+        auto const* c2 = c[2].data();
+        auto const* d1 = c[3].data();
+        auto const* d2 = c[4].data();
+        auto* s1       = state[static_cast<size_t>(2 * s)].data();
+        auto* s2       = state[static_cast<size_t>(2 * s + 1)].data();
+
+        for(int g = firstGroup; g < lastGroup; g++)
+        {
+            auto const x = y[g];
+            y[g]  = c0[g] * x + s1[g];
+            s1[g] = c1[g] * x - d1[g] * y[g] + s2[g];
+            s2[g] = c2[g] * x - d2[g] * y[g];
+        }
+    }
+
+
+    /** One chunk of the bank with the band loops fixed at compile time: groups groups from
+        range.firstGroup, the detector and, unless it is 0, the section count. A count of 0
+        takes numSections at run time, for cascaded bands; the channel counts always come
+        from channels. */
+    template <int groups, int fixedSections, bool rms, bool isRamping>
+    void processChunk(Range const& range, Channels const& channels, float const* const* modulator,
+                      float const* const* carrier, float* const* output, int start, int numSamples)
+    {
+        int const numModChannels = channels.numMod;
+        int const numCarChannels = channels.numCar;
+        int const sections       = fixedSections > 0 ? fixedSections : numSections;
+        bool constexpr cascaded  = fixedSections != 1;
+
+        int constexpr numPartitionsInRange = (groups + groupsPerPartition - 1) / groupsPerPartition;
+
+        //The last section runs in the loops that read its output; the ones before it leave
+        //every group's signal in y, in whole passes across the groups
+        int const first = range.firstGroup;
+        int const last  = (sections - 1) * coefficientsPerSection;
+        auto* c0 = coefficients[static_cast<size_t>(last)].data() + first;
+        auto* c1 = coefficients[static_cast<size_t>(last + 1)].data() + first;
+        auto* c2 = coefficients[static_cast<size_t>(last + 2)].data() + first;
+        auto* d1 = coefficients[static_cast<size_t>(last + 3)].data() + first;
+        auto* d2 = coefficients[static_cast<size_t>(last + 4)].data() + first;
+        auto* gains = gain.data() + first;
+        auto const* gainSteps = gainStep.data() + first;
+        auto const* active    = carrierActive.data() + first / groupsPerPartition;
+
+        std::array<Vec, maxGroups> y;
+
+        for(int i = start; i < start + numSamples; i++)
+        {
+            for(int channel = 0; channel < numModChannels; channel++)
+            {
+                auto const x = Vec::expand(modulator[channel][i]);
+                auto* s1     = modState[channel][static_cast<size_t>(2 * sections - 2)].data() + first;
+                auto* s2     = modState[channel][static_cast<size_t>(2 * sections - 1)].data() + first;
+                auto* env    = envelope[channel].data() + first;
+
+                if (cascaded)
+                {
+                    std::fill(y.begin() + first, y.begin() + first + groups, x);
+                    for(int s = 0; s < sections - 1; s++){filter(y.data(), modState[channel], s, first, first + groups);}
+                }
+
+                for(int g = 0; g < groups; g++)
+                {
+                    auto const in  = cascaded ? y[first + g] : x;
+                    auto const out = c0[g] * in + s1[g];
+                    s1[g] = c1[g] * in - d1[g] * out + s2[g];
+                    s2[g] = c2[g] * in - d2[g] * out;
+
+                    auto const delta = (rms ? out * out : abs(out)) - env[g];
+                    env[g] += delta * envelopeMean + abs(delta) * envelopeHalfDiff;
+                }
+            }
+
+            for(int g = 0; g < groups; g++){gains[g] += gainSteps[g];}
+
+            for(int channel = 0; channel < numCarChannels; channel++)
+            {
+                auto const x = Vec::expand(carrier[channel][i]);
+                auto* s1     = carState[channel][static_cast<size_t>(2 * sections - 2)].data() + first;
+                auto* s2     = carState[channel][static_cast<size_t>(2 * sections - 1)].data() + first;
+                float out    = 0.f;
+
+                for(int p = 0; p < numPartitionsInRange; p++)
+                {
+                    if (! active[p]){continue;}
+
+                    int const firstGroup = p * groupsPerPartition;
+                    int const lastGroup  = (p + 1) * groupsPerPartition < groups ? (p + 1) * groupsPerPartition : groups;
+                    auto sum = Vec::expand(0.f);
+
+                    if (cascaded)
+                    {
+                        std::fill(y.begin() + first + firstGroup, y.begin() + first + lastGroup, x);
+                        for(int s = 0; s < sections - 1; s++){filter(y.data(), carState[channel], s, first + firstGroup, first + lastGroup);}
+                    }
+
+                    for(int g = firstGroup; g < lastGroup; g++)
+                    {
+                        auto const in  = cascaded ? y[first + g] : x;
+                        auto const y0 = c0[g] * in + s1[g];
+                        s1[g] = c1[g] * in - d1[g] * y0 + s2[g];
+                        s2[g] = c2[g] * in - d2[g] * y0;
+                        sum += y0 * gains[g];
+                    }
+
+                    out += sum.sum();
+                }
+
+                output[channel][i] = out;
+            }
+
+            if (isRamping)
+            {
+                for(int c = 0; c < sections * coefficientsPerSection; c++)
+                {
+                    auto* current     = coefficients[static_cast<size_t>(c)].data() + first;
+                    auto const* steps = step[static_cast<size_t>(c)].data() + first;
+                    for(int g = 0; g < groups; g++){current[g] += steps[g];}
+                }
+            }
+        }
+    }
+
+
+    //==============================================================================
+    /** Every processChunk() variant, indexed by getKernelIndex(). Built on first use, without
+        touching the heap. */
+    using Kernel = void (FilterBank::*)(Range const&, Channels const&, float const* const*, float const* const*,
+                                        float* const*, int, int);
+
+    //Single biquads get kernels of their own, cascades of any length share the rest. A range
+    //without buckets never gets this far, so the table starts at one bucket
+    int constexpr static kernelsPerBucket = 8;
+    int constexpr static numKernels       = maxBuckets * kernelsPerBucket;
+
+    static int getKernelIndex(int numBuckets, int numSections, bool rms)
+    {
+        jassert(numBuckets >= 1 && numBuckets <= maxBuckets && numSections >= 1);
+
+        return (numBuckets - 1) * kernelsPerBucket + (numSections > 1 ? 4 : 0) + (rms ? 2 : 0);
+    }
+
+    //The index holds the bucket count less one, whether bands are cascaded, and then one bit
+    //each for the detector and the ramp, the ramping variant following the steady one
+    template <int index>
+    static Kernel getKernel()
+    {
+        return &FilterBank::processChunk<(index / kernelsPerBucket + 1) * groupsPerBucket,
+                                         (index & 4) != 0 ? 0 : 1,
+                                         (index & 2) != 0, (index & 1) != 0>;
+    }
+
+    template <int... indices>
+    static std::array<Kernel, numKernels> makeKernels(std::integer_sequence<int, indices...>)
+    {
+        return {{getKernel<indices>()...}};
+    }
+
+    static std::array<Kernel, numKernels> const& getKernels()
+    {
+        static auto const kernels = makeKernels(std::make_integer_sequence<int, numKernels>());
+        return kernels;
+    }
+
+};
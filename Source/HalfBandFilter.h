@@ -0,0 +1,165 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Linear-phase half-band lowpass shared by the decimator and interpolator below.
+
+    Every other tap of a half-band filter is zero and the centre tap is 1/2, so only
+    the odd offsets from the centre are stored: tap[j] belongs to offsets +-(2j + 1).
+    The Blackman-windowed design passes up to 0.19 and stops from 0.31 of the higher
+    sample rate with about 74 dB of rejection.
+*/
+struct HalfBandTaps
+{
+    int constexpr static numTaps = 47;
+    int constexpr static centre  = (numTaps - 1) / 2;
+    int constexpr static numOdd  = (centre + 1) / 2;
+
+    /** Highest frequency, relative to the higher rate, that passes unchanged. */
+    float constexpr static passband = 0.19f;
+
+    /** Decimating and interpolating again delays by this many samples at the higher rate. */
+    int constexpr static roundTripDelay = 2 * centre - 1;
+
+    std::array<float, numOdd> tap;
+
+
+    static HalfBandTaps const& get()
+    {
+        static HalfBandTaps const taps;
+        return taps;
+    }
+
+
+private:
+
+    HalfBandTaps()
+    {
+        float sum = 0.f;
+
+        for(int j = 0; j < numOdd; j++)
+        {
+            auto const offset = 2 * j + 1;
+            auto const n      = static_cast<double>(centre + offset) / (numTaps - 1);
+            auto const window = 0.42 - 0.5 * std::cos(2.0 * double_Pi * n) + 0.08 * std::cos(4.0 * double_Pi * n);
+            auto const sinc   = std::sin(0.5 * double_Pi * offset) / (double_Pi * offset);
+
+            tap[j] = static_cast<float>(sinc * window);
+            sum   += 2.f * tap[j];
+        }
+
+        //The odd taps must add up to 1/2 for unity gain at DC
+        for(auto& t : tap){t *= 0.5f / sum;}
+    }
+};
+
+
+//==============================================================================
+/** Halves the sample rate of one channel. Keeps the odd input samples, so input
+    samples 2m and 2m + 1 produce output sample m. */
+class HalfBandDecimator
+{
+
+public:
+
+    void reset()
+    {
+        history.fill(0.f);
+        position = 0;
+    }
+
+
+    /** Reads 2 * numOutput samples. */
+    void process(float const* input, float* output, int numOutput)
+    {
+        auto const& taps = HalfBandTaps::get();
+
+        for(int m = 0; m < numOutput; m++)
+        {
+            push(input[2 * m]);
+            push(input[2 * m + 1]);
+
+            //Oldest sample first, so the centre of the filter sits at index centre
+            float const* x = history.data() + position + 1;
+            float y = 0.5f * x[HalfBandTaps::centre];
+
+            for(int j = 0; j < HalfBandTaps::numOdd; j++)
+            {
+                auto const offset = 2 * j + 1;
+                y += taps.tap[j] * (x[HalfBandTaps::centre - offset] + x[HalfBandTaps::centre + offset]);
+            }
+
+            output[m] = y;
+        }
+    }
+
+
+private:
+
+    int constexpr static size = HalfBandTaps::numTaps;
+
+    //Every sample is written twice, so the last size samples are always contiguous
+    std::array<float, 2 * size> history{};
+    int position{};
+
+
+    void push(float x)
+    {
+        position = position + 1 == size ? 0 : position + 1;
+        history[position]        = x;
+        history[position + size] = x;
+    }
+};
+
+
+//==============================================================================
+/** Doubles the sample rate of one channel. The zero-stuffed odd outputs reduce to the
+    centre tap, so they are plain delayed copies of the input. */
+class HalfBandInterpolator
+{
+
+public:
+
+    void reset()
+    {
+        history.fill(0.f);
+        position = 0;
+    }
+
+
+    /** Writes 2 * numInput samples, adding them to what output already holds. */
+    void processAdding(float const* input, float* output, int numInput)
+    {
+        auto const& taps = HalfBandTaps::get();
+
+        for(int m = 0; m < numInput; m++)
+        {
+            position = position + 1 == size ? 0 : position + 1;
+            history[position]        = input[m];
+            history[position + size] = input[m];
+
+            //x[size - 1] is the newest input sample
+            float const* x = history.data() + position + 1;
+            float even = 0.f;
+
+            for(int j = 0; j < HalfBandTaps::numOdd; j++)
+            {
+                even += taps.tap[j] * (x[size - 1 - (HalfBandTaps::centre - 2 * j - 1) / 2]
+                                     + x[size - 1 - (HalfBandTaps::centre + 2 * j + 1) / 2]);
+            }
+
+            output[2 * m]     += 2.f * even;
+            output[2 * m + 1] += x[size - 1 - (HalfBandTaps::centre - 1) / 2];
+        }
+    }
+
+
+private:
+
+    int constexpr static size = HalfBandTaps::centre + 1;
+
+    std::array<float, 2 * size> history{};
+    int position{};
+};
@@ -0,0 +1,221 @@
+#include "MultirateFilterBank.h"
+
+void MultirateFilterBank::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    numTiers   = FilterBankDesign::getNumTiers(sampleRate);
+    chunkSize  = 1 << (numTiers - 1);
+
+    int const capacity = maximumBlockSize + chunkSize;
+
+    //The deepest tier is not delayed; every tier above waits for the round trip below it
+    int delay = 0;
+
+    for(int t = numTiers - 1; t >= 0; t--)
+    {
+        auto& tier = tiers[t];
+
+        tier.modulator.setSize(maxChannels, (capacity >> t) + 1);
+        tier.carrier.setSize(maxChannels, (capacity >> t) + 1);
+        tier.output.setSize(maxChannels, (capacity >> t) + 1);
+
+        tier.delay = delay;
+        tier.delayLine.setSize(maxChannels, juce::jmax(1, delay));
+
+        delay = HalfBandTaps::roundTripDelay + 2 * delay;
+    }
+
+    //Input can wait for up to a chunk before it is processed
+    latency = tiers[0].delay + chunkSize - 1;
+
+    modPending.setSize(maxChannels, capacity);
+    carPending.setSize(maxChannels, capacity);
+    outQueue.setSize(maxChannels, capacity + chunkSize);
+
+    reset();
+}
+
+
+void MultirateFilterBank::reset()
+{
+    for(auto& tier : tiers)
+    {
+        tier.bank.reset();
+
+        for(auto& decimator : tier.modDecimators){decimator.reset();}
+        for(auto& decimator : tier.carDecimators){decimator.reset();}
+        for(auto& interpolator : tier.interpolators){interpolator.reset();}
+
+        tier.delayLine.clear();
+        tier.delayPosition = 0;
+    }
+
+    //Priming the queue with a chunk's worth of silence means a whole block is always ready
+    outQueue.clear();
+    numQueued  = chunkSize - 1;
+    numPending = 0;
+}
+
+
+int MultirateFilterBank::getNumBands() const
+{
+    int numBands = 0;
+    for(int t = 0; t < numTiers; t++){numBands += tiers[t].bank.getNumBands();}
+    return numBands;
+}
+
+
+float MultirateFilterBank::getBandGain(int band) const
+{
+    //The deepest tier holds the lowest bands
+    for(int t = numTiers - 1; t >= 0; t--)
+    {
+        auto const& bank = tiers[t].bank;
+
+        if (band < bank.getNumBands()){return bank.getBandGain(band);}
+        band -= bank.getNumBands();
+    }
+
+    return 0.f;
+}
+
+
+void MultirateFilterBank::setDesign(FilterBankDesign const& design)
+{
+    jassert(design.numTiers == numTiers);
+
+    for(int t = 0; t < numTiers; t++){tiers[t].bank.setDesign(design.tiers[t]);}
+}
+
+
+void MultirateFilterBank::beginRamp(FilterBankDesign const& design, int numSamples)
+{
+    jassert(design.numTiers == numTiers);
+
+    for(int t = 0; t < numTiers; t++){tiers[t].bank.beginRamp(design.tiers[t], juce::jmax(1, numSamples >> t));}
+}
+
+
+void MultirateFilterBank::setEnvelope(float attackMs, float releaseMs, FilterBank::Detector detector)
+{
+    for(int t = 0; t < numTiers; t++){tiers[t].bank.setEnvelope(sampleRate / (1 << t), attackMs, releaseMs, detector);}
+}
+
+
+void MultirateFilterBank::process(float const* const* modulator, int numModChannels,
+                                  float const* const* carrier, float* const* output, int numCarChannels,
+                                  int numSamples, float modGain)
+{
+    jassert(numPending + numSamples <= modPending.getNumSamples());
+
+    //Taking the inputs first is what lets the output alias them
+    for(int channel = 0; channel < numModChannels; channel++){modPending.copyFrom(channel, numPending, modulator[channel], numSamples);}
+    for(int channel = 0; channel < numCarChannels; channel++){carPending.copyFrom(channel, numPending, carrier[channel], numSamples);}
+
+    numPending += numSamples;
+
+    int const numReady = numPending - numPending % chunkSize;
+
+    if (numReady > 0)
+    {
+        processChunks(numReady, numModChannels, numCarChannels, modGain);
+        numQueued  += numReady;
+        numPending -= numReady;
+
+        //Less than a chunk is left, so source and destination never overlap
+        for(int channel = 0; channel < numModChannels; channel++){modPending.copyFrom(channel, 0, modPending, channel, numReady, numPending);}
+        for(int channel = 0; channel < numCarChannels; channel++){carPending.copyFrom(channel, 0, carPending, channel, numReady, numPending);}
+    }
+
+    numQueued -= numSamples;
+
+    for(int channel = 0; channel < numCarChannels; channel++)
+    {
+        auto* queue = outQueue.getWritePointer(channel);
+
+        juce::FloatVectorOperations::copy(output[channel], queue, numSamples);
+        std::memmove(queue, queue + numSamples, static_cast<size_t>(numQueued) * sizeof(float));
+    }
+}
+
+
+void MultirateFilterBank::processChunks(int numSamples, int numModChannels, int numCarChannels, float modGain)
+{
+    float const* modulator[maxTiers][maxChannels] = {};
+    float const* carrier[maxTiers][maxChannels]   = {};
+    float*       output[maxTiers][maxChannels]    = {};
+
+    for(int channel = 0; channel < maxChannels; channel++)
+    {
+        modulator[0][channel] = modPending.getReadPointer(channel);
+        carrier[0][channel]   = carPending.getReadPointer(channel);
+        output[0][channel]    = outQueue.getWritePointer(channel, numQueued);
+    }
+
+    //Analysis: halve both signals down the tiers
+    for(int t = 1; t < numTiers; t++)
+    {
+        auto& tier = tiers[t];
+        int const numTierSamples = numSamples >> t;
+
+        for(int channel = 0; channel < maxChannels; channel++)
+        {
+            modulator[t][channel] = tier.modulator.getReadPointer(channel);
+            carrier[t][channel]   = tier.carrier.getReadPointer(channel);
+            output[t][channel]    = tier.output.getWritePointer(channel);
+        }
+
+        for(int channel = 0; channel < numModChannels; channel++)
+            tier.modDecimators[channel].process(modulator[t - 1][channel], tier.modulator.getWritePointer(channel), numTierSamples);
+
+        for(int channel = 0; channel < numCarChannels; channel++)
+            tier.carDecimators[channel].process(carrier[t - 1][channel], tier.carrier.getWritePointer(channel), numTierSamples);
+    }
+
+    for(int t = 0; t < numTiers; t++)
+    {
+        auto& bank = tiers[t].bank;
+        int const numTierSamples = numSamples >> t;
+
+        bank.process(modulator[t], numModChannels, carrier[t], output[t], numCarChannels, numTierSamples, modGain);
+
+        //A bank without bands leaves its output untouched
+        if (bank.getNumBands() == 0)
+        {
+            for(int channel = 0; channel < numCarChannels; channel++)
+                juce::FloatVectorOperations::clear(output[t][channel], numTierSamples);
+        }
+    }
+
+    //Synthesis: from the deepest tier up, delay each tier's own sum and add the tiers below it
+    for(int t = numTiers - 2; t >= 0; t--)
+    {
+        delayOutput(tiers[t], output[t], numCarChannels, numSamples >> t);
+
+        for(int channel = 0; channel < numCarChannels; channel++)
+            tiers[t + 1].interpolators[channel].processAdding(output[t + 1][channel], output[t][channel], numSamples >> (t + 1));
+    }
+}
+
+
+void MultirateFilterBank::delayOutput(Tier& tier, float* const* output, int numCarChannels, int numSamples)
+{
+    if (tier.delay == 0){return;}
+
+    int position = tier.delayPosition;
+
+    for(int channel = 0; channel < numCarChannels; channel++)
+    {
+        auto* line = tier.delayLine.getWritePointer(channel);
+        auto* data = output[channel];
+        position   = tier.delayPosition;
+
+        for(int i = 0; i < numSamples; i++)
+        {
+            std::swap(line[position], data[i]);
+            position = position + 1 == tier.delay ? 0 : position + 1;
+        }
+    }
+
+    tier.delayPosition = position;
+}
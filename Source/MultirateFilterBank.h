@@ -0,0 +1,88 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterBank.h"
+#include "HalfBandFilter.h"
+
+//==============================================================================
+/**
+    The filter bank split into octave tiers, so every band runs at the lowest sample
+    rate that still holds it and its cost follows its bandwidth instead of the host rate.
+
+    Modulator and carrier are halved through a chain of half-band decimators; the bank
+    of each tier processes its share of the bands at that tier's rate, and the outputs
+    are interpolated back up and summed from the deepest tier upwards. Each tier's own
+    output is delayed to line up with the round trip through the tiers below it.
+
+    Blocks are processed in chunks of 2^(numTiers - 1) samples so every tier always sees
+    whole samples; together with the half-band delays this gives a fixed latency that
+    only depends on the sample rate.
+*/
+class MultirateFilterBank : public SIMDAligned
+{
+
+public:
+
+    int constexpr static maxTiers    = FilterBankDesign::maxTiers;
+    int constexpr static maxChannels = FilterBank::maxChannels;
+
+
+    /** Allocates the tier buffers and resets everything. Not realtime safe. */
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    void reset();
+
+    /** Valid after prepare(). */
+    int getLatencySamples() const { return latency; }
+
+    int getNumBands() const;
+
+    /** As FilterBank::getBandGain(), with the bands of all tiers numbered from the lowest. */
+    float getBandGain(int band) const;
+
+    void setDesign(FilterBankDesign const& design);
+    void beginRamp(FilterBankDesign const& design, int numSamples);
+    void setEnvelope(float attackMs, float releaseMs, FilterBank::Detector detector);
+
+
+    /** Same contract as FilterBank::process(); numSamples must not exceed the prepared block size. */
+    void process(float const* const* modulator, int numModChannels,
+                 float const* const* carrier, float* const* output, int numCarChannels,
+                 int numSamples, float modGain);
+
+
+private:
+
+    struct Tier
+    {
+        FilterBank bank;
+
+        //Decimators that produce this tier's input from the tier above, and the
+        //interpolator that brings this tier's sum back up to it
+        std::array<HalfBandDecimator, maxChannels> modDecimators, carDecimators;
+        std::array<HalfBandInterpolator, maxChannels> interpolators;
+
+        juce::AudioBuffer<float> modulator, carrier, output;
+
+        //Delay of this tier's own output, in samples at the tier rate
+        int delay{};
+        juce::AudioBuffer<float> delayLine;
+        int delayPosition{};
+    };
+
+    double sampleRate{44100.0};
+    int numTiers{1};
+    int chunkSize{1};
+    int latency{};
+
+    std::array<Tier, maxTiers> tiers;
+
+    //Input waiting for a whole chunk, and output waiting to be handed out
+    juce::AudioBuffer<float> modPending, carPending, outQueue;
+    int numPending{};
+    int numQueued{};
+
+
+    void processChunks(int numSamples, int numModChannels, int numCarChannels, float modGain);
+    void delayOutput(Tier& tier, float* const* output, int numCarChannels, int numSamples);
+};
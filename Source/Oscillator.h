@@ -1,106 +1,243 @@
-
 #pragma once
 
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Band-limited wavetables for every waveform, shared by all oscillators.
+
+    Each waveform has one table per octave: level 0 holds harmonics up to
+    waveTableSize / 2, and every further level halves the number of harmonics.
+    The tables are built once per process by additive synthesis and never change.
+*/
+class WaveTables
+{
+
+public:
+
+    int constexpr static numWaveforms  = 4;
+    int constexpr static waveTableBits = 11;
+    int constexpr static waveTableSize = 1 << waveTableBits;
+    int constexpr static numLevels     = waveTableBits;
+
+    //One extra guard sample per table so interpolation never has to wrap
+    int constexpr static tableStride   = waveTableSize + 1;
+
+
+    static WaveTables const& get()
+    {
+        static WaveTables const tables;
+        return tables;
+    }
+
+
+    /** Highest harmonic stored at the given level. */
+    static int getMaxHarmonic(int level)
+    {
+        return (waveTableSize / 2) >> level;
+    }
+
+
+    /** Richest level whose top harmonic still sits below Nyquist at this frequency. */
+    static int getLevel(double sampleRate, float frequency)
+    {
+        auto const harmonics = frequency > 0.f ? static_cast<int>(0.5 * sampleRate / frequency) : getMaxHarmonic(0);
+
+        int level = 0;
+        while (level < numLevels - 1 && getMaxHarmonic(level) > harmonics){level++;}
+        return level;
+    }
+
+
+    float const* getTable(int waveform, int level) const
+    {
+        return data.data() + (waveform * numLevels + level) * tableStride;
+    }
+
+
+private:
+
+    std::vector<float> data;
+
+
+    WaveTables() : data(static_cast<size_t>(numWaveforms * numLevels * tableStride))
+    {
+        std::array<float, waveTableSize> sine;
+        for(int i = 0; i < waveTableSize; i++){sine[i] = static_cast<float>(std::sin(double_Pi * 2.0 * i / waveTableSize));}
+
+        for(int waveform = 0; waveform < numWaveforms; waveform++)
+        {
+            for(int level = 0; level < numLevels; level++)
+            {
+                auto* table = data.data() + (waveform * numLevels + level) * tableStride;
+                fill(waveform, getMaxHarmonic(level), sine, table);
+                table[waveTableSize] = table[0];
+            }
+        }
+    }
+
+
+    /** Fourier series of the naive tables the oscillator used to generate: a sine, a saw
+        rising from -1 to 1, a square that is high for the first half and a triangle
+        that starts at -1 and peaks half way. */
+    static void fill(int waveform, int maxHarmonic, std::array<float, waveTableSize> const& sine, float* table)
+    {
+        auto const pi = static_cast<float>(double_Pi);
+        int constexpr quarter = waveTableSize / 4;
+        int constexpr mask    = waveTableSize - 1;
+
+        std::fill(table, table + waveTableSize, 0.f);
+
+        for(int k = 1; k <= maxHarmonic; k++)
+        {
+            float amplitude = 0.f;
+            int   offset    = 0;
+
+            switch(waveform)
+            {
+                case 0:
+                    amplitude = k == 1 ? 1.f : 0.f;
+                    break;
+
+                case 1:
+                    amplitude = -2.f / (pi * k);
+                    break;
+
+                case 2:
+                    amplitude = k % 2 == 1 ? 4.f / (pi * k) : 0.f;
+                    break;
+
+                case 3:
+                    amplitude = k % 2 == 1 ? -8.f / (pi * pi * k * k) : 0.f;
+                    offset    = quarter;
+                    break;
+            }
+
+            if (amplitude == 0.f){continue;}
+
+            for(int i = 0; i < waveTableSize; i++)
+            {
+                table[i] += amplitude * sine[(k * i + offset) & mask];
+            }
+        }
+    }
+
+};
+
+
+//==============================================================================
+/**
+    Wavetable oscillator reading the shared band-limited tables.
+
+    The phase is a 32-bit accumulator that wraps by overflow, the top bits index the
+    table and the remaining bits interpolate linearly between neighbouring samples.
+    The table level is chosen from the frequency so no harmonic crosses Nyquist.
+*/
 class Oscillator
 {
-    
+
     public:
-    
+
     Oscillator()
+    : tables(WaveTables::get())
     {
-        for(int i = 0; i < waveTableSize; i++)
-        {
-            waveTable[i] = 2.f / waveTableSize * i - 1.f;
-        } 
+        updateTable();
     }
 
-    
+
     void prepare(double sampleRate)
     {
         sampleRate_ = sampleRate;
-        increment = frequency * waveTableSize / sampleRate;
-        phase = fmod(phase + increment, waveTableSize);
-        setWaveform(1);
+        updateIncrement();
     }
-    
-    
+
+
     void setFrequency(float f)
     {
-        increment = f * waveTableSize / sampleRate_;
+        if (f == frequency){return;}
+
         frequency = f;
+        updateIncrement();
     }
-    
-    
+
+
+    /** 0 = sine, 1 = saw, 2 = square, 3 = triangle. Only selects a prebuilt table. */
     void setWaveform(int w)
     {
-        switch(w)
-        {
-                
-            case 0:
-                for(int i = 0; i < waveTableSize; i++)
-                {
-                    waveTable[i] = std::sin(double_Pi * 2.f * i / waveTableSize);
-                }
-                break;
-                
-            case 1:
-                for(int i = 0; i < waveTableSize; i++)
-                {
-                    waveTable[i] = 2.f / waveTableSize * i - 1.f;
-                }
-                break;
-                
-            case 2:
-                for(int i = 0; i < waveTableSize; i++)
-                {
-                    waveTable[i] = i < waveTableSize / 2 ? 1.f : -1.f;
-                }
-                break;
-                
-            case 3:
-                float wts = static_cast<float>(waveTableSize);
-                
-                for(int i = 0; i < waveTableSize; i++)
-                {
-                    
-                    waveTable[i] = i < wts / 2.f ? i / wts * 4.f - 1.f : (wts - i) / wts * 4.f - 1.f;
-                }
-                break;
-        }
+        w = juce::jlimit(0, WaveTables::numWaveforms - 1, w);
+        if (w == waveform){return;}
+
+        waveform = w;
+        updateTable();
     }
-    
-  
+
+
     float processSample()
     {
-        phase = fmod(phase + increment, waveTableSize);
-        return waveTable[static_cast<int>(phase)];
+        auto const sample = lookup(phase);
+        phase += increment;
+        return sample;
     }
-    
-    
-    void processBuffer(juce::AudioBuffer<float>& buffer)
+
+
+    /** Renders one mono block; channels that need the oscillator share this output. */
+    void render(float* output, int numSamples)
     {
-        for(int i = 0; i < buffer.getNumSamples(); i++)
+        auto p = phase;
+
+        for(int i = 0; i < numSamples; i++)
         {
-            phase = fmod(phase + increment, waveTableSize);
-            
-            for(int channel = 0; channel < buffer.getNumChannels(); channel++)
-            {
-                auto* writePointer = buffer.getWritePointer(channel);
-                writePointer[i] = waveTable[static_cast<int>(phase)];
-            }
+            output[i] = lookup(p);
+            p += increment;
         }
+
+        phase = p;
     }
-    
-    
+
+
 private:
-    
-    int constexpr static waveTableSize = 1024;
-    std::array<float, waveTableSize> waveTable;
-    
+
+    int constexpr static fractionBits   = 32 - WaveTables::waveTableBits;
+    uint32_t constexpr static fractionMask = (1u << fractionBits) - 1u;
+    float constexpr static fractionScale = 1.f / static_cast<float>(1u << fractionBits);
+
+    WaveTables const& tables;
+    float const* table = nullptr;
+
+    int   waveform{1};
+    int   level{};
     float frequency{440};
-    float phase{};
-    float increment{};
+    uint32_t phase{};
+    uint32_t increment{};
     double sampleRate_{44100};
-    
-    
+
+
+    float lookup(uint32_t p) const
+    {
+        auto const index    = p >> fractionBits;
+        auto const fraction = static_cast<float>(p & fractionMask) * fractionScale;
+        return table[index] + fraction * (table[index + 1] - table[index]);
+    }
+
+
+    void updateIncrement()
+    {
+        auto const cycles = juce::jlimit(0.0, 0.5, frequency / sampleRate_);
+        increment = static_cast<uint32_t>(cycles * 4294967296.0);
+
+        auto const newLevel = WaveTables::getLevel(sampleRate_, frequency);
+
+        if (newLevel != level)
+        {
+            level = newLevel;
+            updateTable();
+        }
+    }
+
+
+    void updateTable()
+    {
+        table = tables.getTable(waveform, level);
+    }
+
 };
@@ -13,11 +13,12 @@
 
 //==============================================================================
 VocoderAudioProcessorEditor::VocoderAudioProcessorEditor (VocoderAudioProcessor& p)
-    : AudioProcessorEditor (&p), processor (p)
+    : AudioProcessorEditor (&p), processor (p), display (p.getBandMeter()), controls (p)
 {
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    addAndMakeVisible (display);
+    addAndMakeVisible (controls);
+    
+    setSize (jmax (400, controls.getWidth()), displayHeight + controls.getHeight());
 }
 
 VocoderAudioProcessorEditor::~VocoderAudioProcessorEditor()
@@ -29,14 +30,12 @@ void VocoderAudioProcessorEditor::paint (Graphics& g)
 {
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (ResizableWindow::backgroundColourId));
-
-    g.setColour (Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Hello World!", getLocalBounds(), Justification::centred, 1);
 }
 
 void VocoderAudioProcessorEditor::resized()
 {
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
+    auto bounds = getLocalBounds();
+    
+    display.setBounds (bounds.removeFromTop (displayHeight));
+    controls.setBounds (bounds);
 }
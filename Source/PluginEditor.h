@@ -12,9 +12,11 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "BandDisplay.h"
 
 //==============================================================================
 /**
+    The band display above the plugin's parameters.
 */
 class VocoderAudioProcessorEditor  : public AudioProcessorEditor
 {
@@ -30,6 +32,11 @@ private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     VocoderAudioProcessor& processor;
+    
+    BandDisplay display;
+    GenericAudioProcessorEditor controls;
+    
+    int constexpr static displayHeight = 160;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VocoderAudioProcessorEditor)
 };
@@ -21,12 +21,35 @@ AudioProcessorValueTreeState::ParameterLayout createParameters(){
                                                waveformChoices,
                                                1),
         
+        //Carrier Source
+        std::make_unique<AudioParameterChoice>("carrier",
+                                               "Carrier",
+                                               juce::StringArray {"Oscillator", "MIDI Voices", "Sidechain"},
+                                               0),
+        
+        
+        //Processing Mode
+        std::make_unique<AudioParameterChoice>("mode",
+                                               "Mode",
+                                               juce::StringArray {"Filter Bank", "Spectral", "Multirate Filter Bank"},
+                                               0),
+        
+        //Oversampling around the oscillator and bank; eco trades linear phase for cost and latency
+        std::make_unique<AudioParameterChoice>("oversampling",
+                                               "Oversampling",
+                                               juce::StringArray {"Off", "2x", "2x Eco", "4x", "4x Eco"},
+                                               0),
         
         //Number of Bands
         std::make_unique<AudioParameterInt>("num_bands",
                                             "Num Bands",
                                             1, 48, 12),
         
+        //Number of Bands in Spectral Mode
+        std::make_unique<AudioParameterInt>("spectral_bands",
+                                            "Spectral Bands",
+                                            16, FilterBankDesign::maxSpectralBands, 128),
+        
         //Low F
         std::make_unique<AudioParameterFloat>("low_freq",
                                               "Low Frequency",
@@ -44,12 +67,34 @@ AudioProcessorValueTreeState::ParameterLayout createParameters(){
         std::make_unique<AudioParameterFloat>("q",
                                               "Q",
                                               0.01f, 30.f, 5.f),
+
+        //Band Order: biquads per band in series, for steeper band skirts
+        std::make_unique<AudioParameterChoice>("band_order",
+                                               "Band Order",
+                                               juce::StringArray {"2nd Order", "4th Order", "6th Order", "8th Order"},
+                                               0),
         
         //RMS Calc Gain
         std::make_unique<AudioParameterFloat>("rms_gain",
                                               "Modulator Gain",
                                               0.f, 12.f, 2.f),
 
+        //Envelope Attack in ms
+        std::make_unique<AudioParameterFloat>("attack",
+                                              "Envelope Attack",
+                                              0.1f, 100.f, 5.f),
+        
+        //Envelope Release in ms
+        std::make_unique<AudioParameterFloat>("release",
+                                              "Envelope Release",
+                                              1.f, 1000.f, 50.f),
+        
+        //Envelope Detector
+        std::make_unique<AudioParameterChoice>("detector",
+                                               "Envelope Detector",
+                                               juce::StringArray {"RMS", "Peak"},
+                                               0),
+
         //Wide
         std::make_unique<AudioParameterFloat>("wide",
                                               "Freq Interval",
@@ -60,11 +105,26 @@ AudioProcessorValueTreeState::ParameterLayout createParameters(){
                                              "Switch Carr/Mod",
                                              false),
         
+        //one analysis of the modulator downmix drives every channel
+        std::make_unique<AudioParameterBool>("linked",
+                                             "Linked Analysis",
+                                             false),
+        
+        //replay the analysis of another instance fed the same modulator instead of running one
+        std::make_unique<AudioParameterBool>("share_analysis",
+                                             "Share Analysis",
+                                             false),
+        
         //bypass modulator
         std::make_unique<AudioParameterBool>("bypass_mod",
                                              "Bypass Modulator",
                                              false),
         
+        //split the filter bank across cores for offline renders and high band counts
+        std::make_unique<AudioParameterBool>("multi_core",
+                                             "Multi-Core",
+                                             false),
+        
         //Out Gain
         std::make_unique<AudioParameterFloat>("out_gain",
                                               "Output Gain",
@@ -83,6 +143,7 @@ VocoderAudioProcessor::VocoderAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", AudioChannelSet::stereo(), true)
                      #endif
@@ -93,26 +154,52 @@ valueTree(*this, nullptr, juce::Identifier("VSTurboVocoder"), createParameters()
 {
     oscFreq_        = valueTree.getRawParameterValue("osc_freq");
     oscWave_        = valueTree.getRawParameterValue("osc_wave");
+    carrier_        = valueTree.getRawParameterValue("carrier");
     
+    mode_           = valueTree.getRawParameterValue("mode");
+    oversampling_   = valueTree.getRawParameterValue("oversampling");
     numBands_       = valueTree.getRawParameterValue("num_bands");
+    spectralBands_  = valueTree.getRawParameterValue("spectral_bands");
     lowFreq_        = valueTree.getRawParameterValue("low_freq");
     highFreq_       = valueTree.getRawParameterValue("high_freq");
     Q_              = valueTree.getRawParameterValue("q");
+    bandOrder_      = valueTree.getRawParameterValue("band_order");
     rmsGain_        = valueTree.getRawParameterValue("rms_gain");
+    attack_         = valueTree.getRawParameterValue("attack");
+    release_        = valueTree.getRawParameterValue("release");
+    detector_       = valueTree.getRawParameterValue("detector");
     wide_           = valueTree.getRawParameterValue("wide");
     switchCarrMod_  = valueTree.getRawParameterValue("switch_car_mod");
     bypassMod_      = valueTree.getRawParameterValue("bypass_mod");
     outGain_        = valueTree.getRawParameterValue("out_gain");
+    multiCore_      = valueTree.getRawParameterValue("multi_core");
+    linked_         = valueTree.getRawParameterValue("linked");
+    shareAnalysis_  = valueTree.getRawParameterValue("share_analysis");
 
     valueTree.addParameterListener("num_bands", this);
+    valueTree.addParameterListener("spectral_bands", this);
     valueTree.addParameterListener("low_freq", this);
     valueTree.addParameterListener("high_freq", this);
     valueTree.addParameterListener("q", this);
+    valueTree.addParameterListener("band_order", this);
     valueTree.addParameterListener("wide", this);
+    
+    //These are applied by the timer
+    valueTree.addParameterListener("mode", this);
+    valueTree.addParameterListener("oversampling", this);
+    valueTree.addParameterListener("multi_core", this);
+    valueTree.addParameterListener("share_analysis", this);
+    
+   #if JUCE_DEBUG
+    engine.getProfiler().setEnabled(true);
+   #endif
+    
+    startTimerHz(idleTimerHz);
 }
 
 VocoderAudioProcessor::~VocoderAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -150,59 +237,78 @@ bool VocoderAudioProcessor::isMidiEffect() const
 
 double VocoderAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return VocoderEngine::getTailLengthSeconds(getBandLayout(), release_->load(), static_cast<int>(detector_->load()));
 }
 
 int VocoderAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return presets.size();
 }
 
 int VocoderAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
 void VocoderAudioProcessor::setCurrentProgram (int index)
 {
+    if (! isPositiveAndBelow(index, presets.size())){return;}
+    
+    currentProgram = index;
+    
+    //Hosts may switch programs from the audio thread, which must neither notify the host of
+    //every parameter nor publish designs itself, so it only leaves the index for the timer
+    if (Thread::getCurrentThreadId() == audioThreadId.load())
+    {
+        pendingProgram = index;
+        return;
+    }
+    
+    pendingProgram = -1;
+    applyProgram(index);
+}
+
+void VocoderAudioProcessor::applyProgram (int index)
+{
+    loadingState = true;
+    for (auto const& value : presets[index].values){setParameterValue(value.first, value.second);}
+    loadingState = false;
+    
+    //The preset over the current layout, so fields it leaves alone such as the band order stay
+    //as they are; its design is normally waiting in the cache already
+    engine.setBandLayout(presets.getLayout(index, getBandLayout()));
 }
 
 const String VocoderAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return isPositiveAndBelow(index, presets.size()) ? presets[index].name : String();
 }
 
 void VocoderAudioProcessor::changeProgramName (int index, const String& newName)
 {
+    //Factory programs keep their names
+    ignoreUnused(index, newName);
 }
 
 //==============================================================================
 void VocoderAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    lastSampleRate = sampleRate;
-    
-    dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = getTotalNumOutputChannels();
-    
-    oscOutput.setSize(2, samplesPerBlock);
-    modBuffer.setSize(2, samplesPerBlock);
-    carBuffer.setSize(2, samplesPerBlock);
+    preparedOversampling = static_cast<int>(oversampling_->load());
+    engine.prepare(sampleRate, samplesPerBlock, getNumEngineChannels(), getBandLayout(), preparedOversampling);
+    updateLatency();
     
-    for(auto& f : carrierFilters){f.prepare(spec); f.reset();}
-    for(auto& f : modulatorFilters){f.prepare(spec); f.reset();}
+    //The preset designs for the new rate are left to the timer
+    startTimerHz(busyTimerHz);
     
-    updateFilter();
-    
-    osc_.prepare(sampleRate);
+    if (multiCore_->load() > 0.5f){engine.createWorkerPool();}
+    else {engine.releaseWorkerPool();}
+    if (shareAnalysis_->load() > 0.5f){engine.enableSharedAnalysis();}
 }
 
 void VocoderAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    //The worker threads stop with the last instance that lets go; prepareToPlay starts them again
+    engine.releaseWorkerPool();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -212,16 +318,20 @@ bool VocoderAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // Any layout up to the bank's channel count works, from mono to 7.1.4 and third-order ambisonics
+    auto const mainOutput = layouts.getMainOutputChannelSet();
+
+    if (mainOutput.isDisabled() || mainOutput.size() > FilterBank::maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The sidechain carrier may have any layout the bank can take, or be switched off
+    if (layouts.getChannelSet (true, 1).size() > FilterBank::maxChannels)
+        return false;
    #endif
 
     return true;
@@ -229,100 +339,86 @@ bool VocoderAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 }
 #endif
 
+BandLayout VocoderAudioProcessor::getBandLayout() const
+{
+    BandLayout layout;
+    layout.numBands = static_cast<int>(numBands_->load());
+    layout.lowFreq  = lowFreq_->load();
+    layout.highFreq = highFreq_->load();
+    layout.q        = Q_->load();
+    layout.wide     = wide_->load();
+    layout.numSections = static_cast<int>(bandOrder_->load()) + 1;
+    layout.spectralBands = static_cast<int>(spectralBands_->load());
+    return layout;
+}
+
+int VocoderAudioProcessor::getNumEngineChannels() const
+{
+    //Only the main bus is vocoded; a sidechain carrier's channels past these are never read
+    return jmax(getMainBusNumInputChannels(), getMainBusNumOutputChannels());
+}
+
+VocoderParameters VocoderAudioProcessor::getEngineParameters() const
+{
+    VocoderParameters parameters;
+    parameters.oscFreq       = oscFreq_->load();
+    parameters.oscWave       = static_cast<int>(oscWave_->load());
+    parameters.carrier       = static_cast<int>(carrier_->load());
+    parameters.rmsGain       = rmsGain_->load();
+    parameters.attack        = attack_->load();
+    parameters.release       = release_->load();
+    parameters.detector      = static_cast<int>(detector_->load());
+    parameters.switchCarrMod = switchCarrMod_->load() > 0.5f;
+    parameters.bypassMod     = bypassMod_->load() > 0.5f;
+    parameters.outGain       = outGain_->load();
+    parameters.mode          = static_cast<int>(mode_->load());
+    parameters.multiCore     = multiCore_->load() > 0.5f;
+    parameters.linkedAnalysis = linked_->load() > 0.5f;
+    parameters.sharedAnalysis = shareAnalysis_->load() > 0.5f;
+    parameters.nonRealtime   = isNonRealtime();
+    return parameters;
+}
+
 void VocoderAudioProcessor::updateFilter()
 {
-    int numBands = numBands_->load();
-    float highFreq = highFreq_->load();
-    float frequency = lowFreq_->load();
-    float q = Q_->load();
-    float wide = wide_->load();
+    engine.setBandLayout(getBandLayout());
+}
 
-    float freqStep = highFreq / static_cast<float>(numBands);
-    float freqFactor = highFreq / (highFreq - freqStep) * wide;
+void VocoderAudioProcessor::updateLatency()
+{
+    auto const latency = engine.getLatencySamples(static_cast<int>(mode_->load()));
     
-    for(int i = 0; i < numBands; i++)
-    {
-        if (frequency < highFreq)
-        {
-            *carrierFilters[i].state = *juce::dsp::IIR::Coefficients<float>::makeBandPass(lastSampleRate, frequency, q);
-            *modulatorFilters[i].state = *juce::dsp::IIR::Coefficients<float>::makeBandPass(lastSampleRate, frequency, q);
-        }
-
-        frequency *= freqFactor;
-    }
+    if (latency != getLatencySamples()){setLatencySamples(latency);}
 }
 
 
 void VocoderAudioProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
     ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-    
-    int   const numSamples    = buffer.getNumSamples();
-    int   const numChannels   = buffer.getNumChannels();
-    int   const numBands      = numBands_->load();
-    float const outGain       = outGain_->load();
-    float const oscFreq       = oscFreq_->load();
-    int   const oscWave       = oscWave_->load();
-    float const rmsGain       = rmsGain_->load();
-    bool  const switchCarrMod = switchCarrMod_->load();
-    bool  const bypassMod     = bypassMod_->load();
+    RealtimeCheck::ScopedRealtime realtime;
+    audioThreadId = Thread::getCurrentThreadId();
     
+    //Views onto the host's channels, so neither bus is copied on its way into the engine
+    auto mainBuffer = getBusBuffer (buffer, true, 0);
+    auto const numMainInputChannels = getMainBusNumInputChannels();
 
-    osc_.setWaveform(oscWave);
-    osc_.setFrequency(oscFreq);
-    osc_.processBuffer(oscOutput);
-    
+    for (auto i = numMainInputChannels; i < mainBuffer.getNumChannels(); ++i)
+        mainBuffer.clear (i, 0, mainBuffer.getNumSamples());
     
-    //Calculate RMS Value for every band of the incoming signal and store it in the rmsValue-string
-    for (int i = 0; i < numBands; i++)
+    auto const parameters = getEngineParameters();
+    auto const* sidechainBus = getBus (true, 1);
+
+    //The sidechain replaces the internal carrier, which is then not rendered at all
+    if (parameters.carrier == VocoderEngine::sidechainCarrier
+        && sidechainBus != nullptr && sidechainBus->isEnabled() && sidechainBus->getNumberOfChannels() > 0)
     {
-        modBuffer.clear();
-        if(switchCarrMod){modBuffer.makeCopyOf(oscOutput);}
-        else{modBuffer.makeCopyOf(buffer);}
-        
-        auto block   = juce::dsp::AudioBlock<float>(modBuffer);
-        auto modulatorContext = juce::dsp::ProcessContextReplacing<float>(block);
-        modulatorFilters[i].process(modulatorContext);
-        
-        float sum = 0;
-        for (int channel = 0; channel < numChannels; channel++)
-        {
-            sum += modBuffer.getRMSLevel(channel, 0, numSamples) / numChannels;
-        }
-        
-        rmsValues[i] = sum * rmsGain;
+        auto const sidechain = getBusBuffer (buffer, true, 1);
+        engine.process(mainBuffer, sidechain.getArrayOfReadPointers(), sidechain.getNumChannels(), parameters);
+    }
+    else
+    {
+        engine.process(mainBuffer, midiMessages, parameters);
     }
-    
-    buffer.clear();
-    
-    
-    //apply filter-bands on oscillator signal and apply rms-gains to each band accordingly
-    for (int i = 0; i < numBands; i++)
-        {
-            carBuffer.clear();
-            if(switchCarrMod){carBuffer.makeCopyOf(buffer);}
-            else{carBuffer.makeCopyOf(oscOutput);}
-            
-            auto block   = juce::dsp::AudioBlock<float>(carBuffer);
-            auto carrierContext = juce::dsp::ProcessContextReplacing<float>(block);
-            carrierFilters[i].process(carrierContext);
-            
-            carBuffer.applyGain(rmsValues[i]);
-            
-            for (int channel = 0; channel < numChannels; channel++)
-            {
-                auto* filterCalcPointer = carBuffer.getWritePointer(channel);
-                buffer.addFrom(channel, 0, filterCalcPointer, numSamples);
-            }
-        }
-
-    if(bypassMod){buffer.makeCopyOf(oscOutput);}
-    buffer.applyGain(outGain);
 }
 
 //==============================================================================
@@ -333,29 +429,159 @@ bool VocoderAudioProcessor::hasEditor() const
 
 AudioProcessorEditor* VocoderAudioProcessor::createEditor()
 {
-    return new juce::GenericAudioProcessorEditor (*this);
+    return new VocoderAudioProcessorEditor (*this);
 }
 
 //==============================================================================
 void VocoderAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    //Plain values rather than normalised ones, so a later change of a range keeps the sound
+    MemoryOutputStream stream (destData, false);
+    
+    stream.writeInt(stateMagic);
+    stream.writeInt(stateVersion);
+    stream.writeCompressedInt(currentProgram);
+    
+    auto const& parameters = getParameters();
+    stream.writeCompressedInt(parameters.size());
+    
+    for (auto* parameter : parameters)
+    {
+        auto* ranged = static_cast<RangedAudioParameter*>(parameter);
+        
+        stream.writeString(ranged->paramID);
+        stream.writeFloat(ranged->convertFrom0to1(ranged->getValue()));
+    }
 }
 
 void VocoderAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    MemoryInputStream stream (data, static_cast<size_t>(sizeInBytes), false);
+    
+    if (sizeInBytes < 8 || stream.readInt() != stateMagic){return;}
+    
+    auto const version = stream.readInt();
+    if (version < 1 || version > stateVersion){return;}
+    
+    auto const program   = stream.readCompressedInt();
+    auto const numValues = stream.readCompressedInt();
+    
+    loadingState = true;
+    
+    for (int i = 0; i < numValues && ! stream.isExhausted(); i++)
+    {
+        auto const parameterID = stream.readString();
+        setParameterValue(parameterID, stream.readFloat());
+    }
+    
+    loadingState = false;
+    
+    //A program switch still waiting for the timer would otherwise overwrite the restored values
+    pendingProgram = -1;
+    currentProgram = jlimit(0, presets.size() - 1, program);
+    updateFilter();
+}
+
+void VocoderAudioProcessor::setParameterValue(const juce::String& parameterID, float value)
+{
+    if (auto* parameter = valueTree.getParameter(parameterID))
+    {
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
 }
 
 void VocoderAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
 {
-    juce::ignoreUnused(parameterID, newValue);
+    juce::ignoreUnused(newValue);
+    
+    auto const onAudioThread = Thread::getCurrentThreadId() == audioThreadId.load();
+    
+    //The timer picks these up itself; it is only hurried along when that is safe here
+    if (parameterID == "mode" || parameterID == "oversampling" || parameterID == "multi_core" || parameterID == "share_analysis")
+    {
+        if (! onAudioThread){startTimerHz(busyTimerHz);}
+        return;
+    }
+    
+    if (loadingState.load()){return;}
+    
+    if (onAudioThread)
+    {
+        designPending = true;
+        return;
+    }
+    
     updateFilter();
 }
 
+void VocoderAudioProcessor::timerCallback()
+{
+    auto const rate = handlePendingWork() ? busyTimerHz : idleTimerHz;
+    if (getTimerInterval() != 1000 / rate){startTimerHz(rate);}
+}
+
+bool VocoderAudioProcessor::handlePendingWork()
+{
+    bool handled = false;
+    
+    auto const program = pendingProgram.exchange(-1);
+    
+    if (program >= 0)
+    {
+        applyProgram(program);
+        handled = true;
+    }
+    
+    if (designPending.exchange(false))
+    {
+        updateFilter();
+        handled = true;
+    }
+    
+    //The oversampling buffers are sized in prepare, so a new setting re-prepares with the callback held off
+    auto const oversampling = static_cast<int>(oversampling_->load());
+    
+    if (oversampling != preparedOversampling && getSampleRate() > 0)
+    {
+        suspendProcessing(true);
+        preparedOversampling = oversampling;
+        engine.prepare(getSampleRate(), getBlockSize(), getNumEngineChannels(), getBandLayout(), oversampling);
+        suspendProcessing(false);
+        handled = true;
+    }
+    
+    //Preset designs are made here rather than in prepare, and only when the inner rate or the band
+    //order is new to them, so a host that prepares on every transport start does not design every
+    //preset each time
+    if (getSampleRate() > 0 && ! presets.isReady(engine, getBandLayout()))
+    {
+        presets.precompute(engine, getBandLayout());
+        handled = true;
+    }
+    
+    //The spectral mode and the oversampling filters delay the output, so the host is told whenever they change
+    updateLatency();
+    
+    //Worker threads run only while multi-core processing is on; the callback is held off while
+    //they are let go, since it may be using them
+    auto const hadWorkerPool = engine.hasWorkerPool();
+    
+    if (multiCore_->load() > 0.5f){engine.createWorkerPool();}
+    else if (hadWorkerPool)
+    {
+        suspendProcessing(true);
+        engine.releaseWorkerPool();
+        suspendProcessing(false);
+    }
+    
+    handled = handled || engine.hasWorkerPool() != hadWorkerPool;
+    
+    //...and the engine only joins the shared analysis once sharing is first switched on
+    if (shareAnalysis_->load() > 0.5f){engine.enableSharedAnalysis();}
+    
+    return handled;
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -2,13 +2,16 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "Oscillator.h"
+#include "VocoderEngine.h"
+#include "PresetBank.h"
 
 //==============================================================================
 /**
 */
 class VocoderAudioProcessor  : public AudioProcessor,
-                               public juce::AudioProcessorValueTreeState::Listener
+                               public SIMDAligned,
+                               public juce::AudioProcessorValueTreeState::Listener,
+                               private juce::Timer
 {
 public:
     //==============================================================================
@@ -48,41 +51,90 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    /** Designs the band-pass filters for the current parameters and publishes them to the
+        audio thread, which ramps to them over its next block. Never call from processBlock. */
     void updateFilter();
+    
+    /** Stage timings of the audio callback; recording is on by default in debug builds. */
+    AudioThreadProfiler& getProfiler() { return engine.getProfiler(); }
+    
+    /** Band levels for the editor; the audio thread only fills it while the editor is open. */
+    BandMeter& getBandMeter() { return engine.getBandMeter(); }
+    
+    /** Reports the latency of the selected mode to the host if it changed. Never call from processBlock. */
+    void updateLatency();
 
 private:
 
     juce::AudioProcessorValueTreeState valueTree;
 
-    int lastSampleRate{};
-
-    using Filter = juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients<float>>;
-    constexpr static int numFilters = 48;
-    std::array<Filter, numFilters> carrierFilters;
-    std::array<Filter, numFilters> modulatorFilters;
-    std::array<float, numFilters> rmsValues;
+    VocoderEngine engine;
     
-    juce::AudioBuffer<float> oscOutput;
-    juce::AudioBuffer<float> modBuffer;
-    juce::AudioBuffer<float> carBuffer;
-
-    Oscillator osc_;
+    PresetBank presets;
+    std::atomic<int> currentProgram{0};
+    
+    //A program chosen on the audio thread, applied by the timer; -1 when none is waiting
+    std::atomic<int> pendingProgram{-1};
+    
+    /** Sets the program's parameter values and hands its design to the engine. Message thread only. */
+    void applyProgram(int index);
+    
+    //Saved state starts with these so foreign or future data is ignored instead of misread
+    int constexpr static stateMagic   = 0x56545356;
+    int constexpr static stateVersion = 1;
+    
+    //Programs and saved state set many parameters at once, then design the bank a single time
+    std::atomic<bool> loadingState{false};
+    
+    /** Sets a parameter from its plain value; unknown IDs are ignored. */
+    void setParameterValue(const juce::String& parameterID, float value);
+    
+    //Parameter changes that arrive on the audio thread are designed later on the message thread
+    std::atomic<juce::Thread::ThreadID> audioThreadId{nullptr};
+    std::atomic<bool> designPending{false};
+    
+    //The setting the engine was last prepared with, so the timer can spot a change
+    int preparedOversampling{0};
+    
+    //The timer only runs fast while it has work; otherwise it idles, since work left by the
+    //audio thread can only be noticed by polling
+    int constexpr static busyTimerHz = 60;
+    int constexpr static idleTimerHz = 4;
+    
+    /** Does whatever the timer finds waiting; returns false if there was nothing. */
+    bool handlePendingWork();
 
     
     std::atomic<float>* oscFreq_ = nullptr;
     std::atomic<float>* oscWave_ = nullptr;
+    std::atomic<float>* carrier_ = nullptr;
     
+    std::atomic<float>* mode_     = nullptr;
+    std::atomic<float>* oversampling_ = nullptr;
     std::atomic<float>* numBands_ = nullptr;
+    std::atomic<float>* spectralBands_ = nullptr;
     std::atomic<float>* lowFreq_  = nullptr;
     std::atomic<float>* highFreq_ = nullptr;
     std::atomic<float>* Q_        = nullptr;
+    std::atomic<float>* bandOrder_ = nullptr;
     std::atomic<float>* rmsGain_  = nullptr;
+    std::atomic<float>* attack_   = nullptr;
+    std::atomic<float>* release_  = nullptr;
+    std::atomic<float>* detector_ = nullptr;
     std::atomic<float>* wide_            = nullptr;
     std::atomic<float>* switchCarrMod_   = nullptr;
     std::atomic<float>* bypassMod_       = nullptr;
     std::atomic<float>* outGain_  = nullptr;
+    std::atomic<float>* multiCore_       = nullptr;
+    std::atomic<float>* linked_          = nullptr;
+    std::atomic<float>* shareAnalysis_   = nullptr;
+
+    BandLayout getBandLayout() const;
+    int getNumEngineChannels() const;
+    VocoderParameters getEngineParameters() const;
 
     void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void timerCallback() override;
    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VocoderAudioProcessor)
 };
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "VocoderEngine.h"
+
+//==============================================================================
+/**
+    The factory programs, each a list of parameter values addressed by parameter ID.
+    Parameters a preset leaves out keep their current value.
+
+    The band designs of all presets are fetched ahead of time on the message thread,
+    once per sample rate and band order, and held here so that DesignCache keeps them;
+    switching programs during playback then finds its design there instead of designing
+    the whole bank again. Every instance at the same settings shares one copy of each.
+*/
+class PresetBank
+{
+
+public:
+
+    struct Preset
+    {
+        juce::String name;
+        std::vector<std::pair<juce::String, float>> values;
+    };
+
+
+    PresetBank()
+    : presets {
+        { "Classic",      { {"osc_wave", 1}, {"num_bands", 12}, {"low_freq", 100}, {"high_freq", 20000}, {"q", 5},  {"wide", 1.5f},
+                            {"spectral_bands", 128}, {"attack", 5},  {"release", 50} } },
+        { "Robot",        { {"osc_wave", 2}, {"osc_freq", 110}, {"num_bands", 16}, {"low_freq", 80}, {"high_freq", 12000}, {"q", 8},
+                            {"wide", 1.35f}, {"spectral_bands", 128}, {"attack", 2}, {"release", 30} } },
+        { "Choir",        { {"osc_wave", 1}, {"carrier", 1}, {"num_bands", 32}, {"low_freq", 60}, {"high_freq", 16000}, {"q", 12},
+                            {"wide", 1.15f}, {"spectral_bands", 256}, {"attack", 8}, {"release", 120} } },
+        { "Whisper",      { {"osc_wave", 0}, {"num_bands", 48}, {"low_freq", 200}, {"high_freq", 18000}, {"q", 20},
+                            {"wide", 1.1f}, {"spectral_bands", 512}, {"attack", 1}, {"release", 20} } },
+        { "Lo-Fi Radio",  { {"osc_wave", 3}, {"num_bands", 6}, {"low_freq", 300}, {"high_freq", 4000}, {"q", 3},
+                            {"wide", 2.f}, {"spectral_bands", 32}, {"attack", 10}, {"release", 80} } },
+        { "Sidechain Pad", { {"carrier", 2}, {"num_bands", 24}, {"low_freq", 100}, {"high_freq", 16000}, {"q", 10},
+                            {"wide", 1.25f}, {"spectral_bands", 256}, {"attack", 5}, {"release", 200} } }
+      }
+    {
+        designs.resize(presets.size());
+    }
+
+
+    int size() const                              { return static_cast<int>(presets.size()); }
+    Preset const& operator[](int index) const     { return presets[static_cast<size_t>(index)]; }
+
+
+    /** The band layout a preset selects; fields it does not set come from base. */
+    BandLayout getLayout(int index, BandLayout layout) const
+    {
+        for (auto const& value : presets[static_cast<size_t>(index)].values)
+        {
+            auto const& name = value.first;
+
+            if      (name == "num_bands")      layout.numBands      = juce::roundToInt(value.second);
+            else if (name == "spectral_bands") layout.spectralBands = juce::roundToInt(value.second);
+            else if (name == "low_freq")       layout.lowFreq       = value.second;
+            else if (name == "high_freq")      layout.highFreq      = value.second;
+            else if (name == "q")              layout.q             = value.second;
+            else if (name == "band_order")     layout.numSections   = juce::roundToInt(value.second) + 1;
+            else if (name == "wide")           layout.wide          = value.second;
+        }
+
+        return layout;
+    }
+
+
+    /** Fetches every preset's design for the engine's current rate, with the fields no preset
+        sets (e.g. the band order) taken from base. Call after the engine is prepared; never
+        from the audio thread. */
+    void precompute(VocoderEngine const& engine, BandLayout const& base)
+    {
+        for (int i = 0; i < size(); i++)
+            designs[static_cast<size_t>(i)] = engine.getBandDesign(getLayout(i, base));
+    }
+
+
+    /** True if every preset's design was made for the engine's current rate and for base,
+        so picking a program on top of it finds its design in DesignCache. */
+    bool isReady(VocoderEngine const& engine, BandLayout const& base) const
+    {
+        for (int i = 0; i < size(); i++)
+        {
+            auto const& entry = designs[static_cast<size_t>(i)];
+            if (entry == nullptr){return false;}
+
+            auto layout = getLayout(i, base);
+            layout.sampleRate = engine.getSampleRate();
+
+            if (! DesignCache::isSameLayout(entry->getLayout(), layout)){return false;}
+        }
+
+        return true;
+    }
+
+
+private:
+
+    std::vector<Preset> presets;
+    std::vector<DesignCache::Entry::Ptr> designs;
+
+};
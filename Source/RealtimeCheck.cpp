@@ -0,0 +1,200 @@
+#include "RealtimeCheck.h"
+
+//The trapped malloc reads these, so they must not be allocated lazily by malloc themselves
+#if VOCODER_TRAP_REALTIME_VIOLATIONS && (JUCE_LINUX || JUCE_ANDROID)
+ #define VOCODER_TRAP_TLS __attribute__((tls_model("initial-exec")))
+#else
+ #define VOCODER_TRAP_TLS
+#endif
+
+namespace
+{
+    thread_local int realtimeDepth VOCODER_TRAP_TLS = 0;
+
+    //Reporting may allocate (assertion logging does), which must not report again
+    thread_local bool reporting VOCODER_TRAP_TLS = false;
+
+    std::atomic<int> numViolations{0};
+    std::atomic<char const*> lastViolation{nullptr};
+}
+
+
+bool RealtimeCheck::isRealtimeThread() noexcept
+{
+    return realtimeDepth > 0;
+}
+
+
+void RealtimeCheck::assertNotRealtime(char const* what) noexcept
+{
+    if (realtimeDepth == 0 || reporting){return;}
+
+    reporting = true;
+
+    numViolations.fetch_add(1, std::memory_order_relaxed);
+    lastViolation.store(what, std::memory_order_relaxed);
+
+    //Realtime violation: look up the call stack for the allocation or lock on the audio thread
+    jassertfalse;
+
+    reporting = false;
+}
+
+
+int RealtimeCheck::getNumViolations() noexcept
+{
+    return numViolations.load(std::memory_order_relaxed);
+}
+
+
+char const* RealtimeCheck::getLastViolation() noexcept
+{
+    return lastViolation.load(std::memory_order_relaxed);
+}
+
+
+RealtimeCheck::ScopedRealtime::ScopedRealtime() noexcept  { ++realtimeDepth; }
+RealtimeCheck::ScopedRealtime::~ScopedRealtime() noexcept { --realtimeDepth; }
+
+
+//==============================================================================
+#if VOCODER_TRAP_REALTIME_VIOLATIONS
+
+void* operator new(std::size_t size)
+{
+    RealtimeCheck::assertNotRealtime("operator new");
+
+    if (auto* memory = std::malloc(size > 0 ? size : 1)){return memory;}
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept
+{
+    RealtimeCheck::assertNotRealtime("operator new");
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size)                              { return operator new(size); }
+void* operator new[](std::size_t size, std::nothrow_t const& tag) noexcept { return operator new(size, tag); }
+
+void operator delete(void* memory) noexcept
+{
+    if (memory != nullptr){RealtimeCheck::assertNotRealtime("operator delete");}
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::nothrow_t const&) noexcept  { operator delete(memory); }
+void operator delete[](void* memory) noexcept                       { operator delete(memory); }
+void operator delete[](void* memory, std::nothrow_t const&) noexcept { operator delete(memory); }
+void operator delete(void* memory, std::size_t) noexcept            { operator delete(memory); }
+void operator delete[](void* memory, std::size_t) noexcept          { operator delete(memory); }
+
+
+//==============================================================================
+//The C allocator and mutexes are trapped as well, since JUCE and the standard library reach
+//them without going through operator new. Trylock is left alone: it never blocks.
+#if JUCE_LINUX || JUCE_ANDROID
+
+#include <pthread.h>
+#include <dlfcn.h>
+
+//glibc's own entry points, which the replacements below forward to
+extern "C" void* __libc_malloc(std::size_t);
+extern "C" void* __libc_calloc(std::size_t, std::size_t);
+extern "C" void* __libc_realloc(void*, std::size_t);
+extern "C" void  __libc_free(void*);
+
+extern "C" void* malloc(std::size_t size) noexcept
+{
+    RealtimeCheck::assertNotRealtime("malloc");
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size) noexcept
+{
+    RealtimeCheck::assertNotRealtime("calloc");
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* memory, std::size_t size) noexcept
+{
+    RealtimeCheck::assertNotRealtime("realloc");
+    return __libc_realloc(memory, size);
+}
+
+extern "C" void free(void* memory) noexcept
+{
+    if (memory != nullptr){RealtimeCheck::assertNotRealtime("free");}
+    __libc_free(memory);
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+{
+    using MutexLock = int (*)(pthread_mutex_t*);
+
+    //Looked up on first use without a lock or a guarded static, either of which would land back here
+    static std::atomic<MutexLock> original{nullptr};
+    auto lock = original.load(std::memory_order_relaxed);
+
+    if (lock == nullptr)
+    {
+        lock = reinterpret_cast<MutexLock>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        original.store(lock, std::memory_order_relaxed);
+    }
+
+    RealtimeCheck::assertNotRealtime("pthread_mutex_lock");
+    return lock(mutex);
+}
+
+#elif JUCE_MAC || JUCE_IOS
+
+#include <pthread.h>
+
+//dyld swaps every other image's calls for these; calls from this image keep the originals
+namespace
+{
+    void* trappedMalloc(std::size_t size)
+    {
+        RealtimeCheck::assertNotRealtime("malloc");
+        return malloc(size);
+    }
+
+    void* trappedCalloc(std::size_t count, std::size_t size)
+    {
+        RealtimeCheck::assertNotRealtime("calloc");
+        return calloc(count, size);
+    }
+
+    void* trappedRealloc(void* memory, std::size_t size)
+    {
+        RealtimeCheck::assertNotRealtime("realloc");
+        return realloc(memory, size);
+    }
+
+    void trappedFree(void* memory)
+    {
+        if (memory != nullptr){RealtimeCheck::assertNotRealtime("free");}
+        free(memory);
+    }
+
+    int trappedMutexLock(pthread_mutex_t* mutex)
+    {
+        RealtimeCheck::assertNotRealtime("pthread_mutex_lock");
+        return pthread_mutex_lock(mutex);
+    }
+
+    struct Interpose { void const* replacement; void const* original; };
+
+    __attribute__((used, section("__DATA,__interpose"))) Interpose const interposers[] =
+    {
+        { reinterpret_cast<void const*>(&trappedMalloc),    reinterpret_cast<void const*>(&malloc) },
+        { reinterpret_cast<void const*>(&trappedCalloc),    reinterpret_cast<void const*>(&calloc) },
+        { reinterpret_cast<void const*>(&trappedRealloc),   reinterpret_cast<void const*>(&realloc) },
+        { reinterpret_cast<void const*>(&trappedFree),      reinterpret_cast<void const*>(&free) },
+        { reinterpret_cast<void const*>(&trappedMutexLock), reinterpret_cast<void const*>(&pthread_mutex_lock) }
+    };
+}
+
+#endif
+
+#endif
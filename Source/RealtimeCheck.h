@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Set to 1 to replace the global operator new and delete with versions that report any
+    heap use on a thread inside a RealtimeCheck::ScopedRealtime. On Linux and macOS malloc,
+    calloc, realloc, free and pthread_mutex_lock are interposed as well, which catches locks
+    and allocations made inside JUCE and the standard library.
+
+    Only for executables such as the render tool and the tests. A plugin is loaded after
+    the host has bound these symbols, so it would trap little of its own while exporting an
+    allocator into the host; plugins rely on the explicit assertNotRealtime() checks. */
+#ifndef VOCODER_TRAP_REALTIME_VIOLATIONS
+ #define VOCODER_TRAP_REALTIME_VIOLATIONS 0
+#endif
+
+#if VOCODER_TRAP_REALTIME_VIOLATIONS && defined (JucePlugin_Name)
+ #error "VOCODER_TRAP_REALTIME_VIOLATIONS replaces the process allocator and only works in executables"
+#endif
+
+//==============================================================================
+/**
+    Debug aid that proves the audio path stays realtime safe.
+
+    processBlock marks its thread with a ScopedRealtime. Every call into code that takes a
+    lock or designs filters is reported (see assertNotRealtime()), and with the trap
+    compiled in, so is every heap allocation or release made on a marked thread. A report
+    counts a violation and raises a jassert, so the debugger stops at the culprit.
+*/
+namespace RealtimeCheck
+{
+    /** True while the calling thread is inside a ScopedRealtime. */
+    bool isRealtimeThread() noexcept;
+
+    /** Records a violation unless the calling thread is outside any ScopedRealtime. */
+    void assertNotRealtime(char const* what) noexcept;
+
+    /** Number of violations since the process started. */
+    int getNumViolations() noexcept;
+
+    /** Description of the most recent violation, or nullptr. */
+    char const* getLastViolation() noexcept;
+
+
+    struct ScopedRealtime
+    {
+        ScopedRealtime() noexcept;
+        ~ScopedRealtime() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtime)
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstddef>
+
+//==============================================================================
+/**
+    Base for classes that hold SIMD registers, so they keep the registers' alignment
+    when they are created with new.
+
+    An AVX register needs 32-byte alignment, more than operator new promises before
+    C++17, so these classes allocate through the operators below; on the stack and as
+    members the compiler aligns them anyway. Every class with registers among its own
+    members derives from this, and so does every class holding one of those that may be
+    allocated by itself, such as VocoderEngine and the plugin's processor.
+*/
+struct SIMDAligned
+{
+    std::size_t constexpr static alignment = alignof(juce::dsp::SIMDRegister<float>);
+
+    //With SSE or NEON the global new already aligns enough and is used as it is
+    bool constexpr static overAligned = alignment > alignof(std::max_align_t);
+
+
+    static void* operator new(std::size_t size)
+    {
+        if (! overAligned){return ::operator new(size);}
+
+        //The block from the global new sits just before the aligned address handed out
+        auto* const block   = static_cast<char*>(::operator new(size + alignment));
+        auto const address  = (reinterpret_cast<std::uintptr_t>(block) + alignment) & ~static_cast<std::uintptr_t>(alignment - 1);
+        auto* const aligned = reinterpret_cast<void*>(address);
+
+        reinterpret_cast<void**>(aligned)[-1] = block;
+        return aligned;
+    }
+
+    static void operator delete(void* memory) noexcept
+    {
+        if (memory == nullptr){return;}
+
+        if (overAligned){::operator delete(reinterpret_cast<void**>(memory)[-1]);}
+        else {::operator delete(memory);}
+    }
+
+    static void* operator new[](std::size_t size)          { return operator new(size); }
+    static void  operator delete[](void* memory) noexcept  { operator delete(memory); }
+
+    //Declaring the above hides the global placement form, which members may still use
+    static void* operator new(std::size_t, void* place) noexcept   { return place; }
+    static void  operator delete(void*, void*) noexcept            {}
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterBank.h"
+
+//==============================================================================
+/**
+    Lets vocoders in one process that analyse the same modulator with the same settings,
+    e.g. several instances on one vocal bus with different carriers, pay for the analysis
+    once: the first bank to process a block publishes the band levels it recorded and
+    the others replay them with FilterBank::follow().
+
+    Blocks are found by FilterBank::getAnalysisKey(), which covers the modulator samples
+    as well as every setting the levels depend on, so a bank only ever replays levels it
+    would have computed itself. Each sample rate has a group holding a ring of the most
+    recent blocks. Every slot is guarded by a sequence counter that is odd while a writer
+    fills it: readers never wait and treat a slot that changed under them as a miss, and
+    a writer that finds its slot taken simply drops its block.
+*/
+class SharedAnalysis
+{
+
+public:
+
+    class Group
+    {
+
+    public:
+
+        explicit Group(double rate)
+        : sampleRate(rate)
+        {
+        }
+
+
+        double getSampleRate() const { return sampleRate; }
+
+
+        /** Audio thread. Copies the levels another stream published under key into frame and
+            returns true, or returns false if no complete block with that key is in the ring.
+            A stream never replays its own blocks, which could come from an earlier stretch of
+            the same signal and so from different envelope history. */
+        bool read(void const* reader, uint64_t key, AnalysisFrame& frame) const noexcept
+        {
+            auto const newest = next.load(std::memory_order_acquire);
+
+            //Newest first: a reader usually runs right after the bank that published its block
+            for(uint32_t i = 1; i <= numSlots; i++)
+            {
+                auto const& slot    = slots[(newest - i) % numSlots];
+                auto const sequence = slot.sequence.load(std::memory_order_acquire);
+
+                if ((sequence & 1u) != 0 || slot.key.load(std::memory_order_relaxed) != key
+                 || slot.writer.load(std::memory_order_relaxed) == reader){continue;}
+
+                //The copy may race with a writer; the second look at the sequence throws it away then
+                frame.numUpdates = slot.frame.numUpdates;
+                if (frame.numUpdates < 0 || frame.numUpdates > AnalysisFrame::maxUpdates){continue;}
+
+                std::memcpy(frame.levels.data(), slot.frame.levels.data(), sizeof(frame.levels[0]) * static_cast<size_t>(frame.numUpdates));
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == sequence){return true;}
+            }
+
+            return false;
+        }
+
+
+        /** Audio thread. Publishes a recorded frame under key, overwriting the oldest block. */
+        void publish(void const* writer, uint64_t key, AnalysisFrame const& frame) noexcept
+        {
+            if (frame.numUpdates < 0){return;}
+
+            auto& slot    = slots[next.fetch_add(1, std::memory_order_acq_rel) % numSlots];
+            auto sequence = slot.sequence.load(std::memory_order_relaxed);
+
+            if ((sequence & 1u) != 0 || ! slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)){return;}
+            std::atomic_thread_fence(std::memory_order_release);
+
+            slot.key.store(key, std::memory_order_relaxed);
+            slot.writer.store(writer, std::memory_order_relaxed);
+            slot.frame.numUpdates = frame.numUpdates;
+            std::memcpy(slot.frame.levels.data(), frame.levels.data(), sizeof(frame.levels[0]) * static_cast<size_t>(frame.numUpdates));
+
+            slot.sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+
+    private:
+
+        //Several host blocks' worth of sub-blocks from a few streams
+        uint32_t constexpr static numSlots = 32;
+
+        struct Slot
+        {
+            std::atomic<uint32_t> sequence{0};
+            std::atomic<uint64_t> key{0};
+            std::atomic<void const*> writer{nullptr};
+            AnalysisFrame frame;
+        };
+
+        double const sampleRate;
+        std::array<Slot, numSlots> slots;
+        std::atomic<uint32_t> next{0};
+
+        JUCE_DECLARE_NON_COPYABLE(Group)
+    };
+
+
+    /** The group for a sample rate, created on first use. Groups live as long as the process,
+        so the pointer stays valid for the audio thread. Never call from the audio thread. */
+    static Group* getGroup(double sampleRate)
+    {
+        static juce::CriticalSection lock;
+        static juce::OwnedArray<Group> groups;
+
+        const juce::ScopedLock scopedLock(lock);
+
+        for(auto* group : groups){if (group->getSampleRate() == sampleRate){return group;}}
+
+        groups.add(new Group(sampleRate));
+        return groups.getLast();
+    }
+
+};
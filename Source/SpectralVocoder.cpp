@@ -0,0 +1,184 @@
+#include "SpectralVocoder.h"
+
+void SpectralVocoder::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+
+    //About 43 ms of analysis at any rate, which resolves bins of ~21 Hz
+    int const fftOrder = 11 + (sampleRate > 50000.0 ? 1 : 0) + (sampleRate > 100000.0 ? 1 : 0);
+
+    fft      = std::make_unique<juce::dsp::FFT>(fftOrder);
+    fftSize  = fft->getSize();
+    hopSize  = fftSize / 4;
+    numBins  = fftSize / 2 + 1;
+
+    //Periodic Hann: its squares overlap-add to a constant at a quarter-frame hop
+    window.resize(static_cast<size_t>(fftSize));
+    for(int k = 0; k < fftSize; k++){window[k] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * k / fftSize);}
+
+    float windowPower = 0.f;
+    for(auto w : window){windowPower += w * w;}
+
+    //Parseval over the one-sided spectrum, divided by the power of the window
+    energyScale  = 2.f / (static_cast<float>(fftSize) * windowPower);
+    overlapScale = static_cast<float>(hopSize) / windowPower;
+
+    for(int channel = 0; channel < maxChannels; channel++)
+    {
+        modInput[channel].assign(static_cast<size_t>(fftSize), 0.f);
+        carInput[channel].assign(static_cast<size_t>(fftSize), 0.f);
+        outputSum[channel].assign(static_cast<size_t>(fftSize), 0.f);
+    }
+
+    frame.assign(static_cast<size_t>(2 * fftSize), 0.f);
+    binBand.assign(static_cast<size_t>(numBins), -1);
+    binGain.assign(static_cast<size_t>(numBins), 0.f);
+
+    reset();
+}
+
+
+void SpectralVocoder::reset()
+{
+    for(int channel = 0; channel < maxChannels; channel++)
+    {
+        std::fill(modInput[channel].begin(), modInput[channel].end(), 0.f);
+        std::fill(carInput[channel].begin(), carInput[channel].end(), 0.f);
+        std::fill(outputSum[channel].begin(), outputSum[channel].end(), 0.f);
+    }
+
+    envelope.fill(0.f);
+    position   = 0;
+    hopCounter = 0;
+}
+
+
+void SpectralVocoder::setBands(FilterBankDesign const& design)
+{
+    float const binWidth = static_cast<float>(sampleRate) / static_cast<float>(fftSize);
+    int band = 0;
+
+    //Bands that drop out start from rest if a later layout brings them back, since only the
+    //active ones are updated per frame
+    std::fill(envelope.begin() + design.numSpectralBands, envelope.end(), 0.f);
+    numBands = design.numSpectralBands;
+
+    //Both the edges and the bins ascend, so one walk assigns every bin to the band containing it
+    for(int k = 0; k < numBins; k++)
+    {
+        float const frequency = static_cast<float>(k) * binWidth;
+
+        while (band < design.numSpectralBands && frequency >= design.spectralEdges[band + 1]){band++;}
+
+        bool const inside = frequency >= design.spectralEdges[0] && band < design.numSpectralBands;
+        binBand[k] = inside ? band : -1;
+    }
+}
+
+
+void SpectralVocoder::setEnvelope(float attackMs, float releaseMs)
+{
+    //The envelopes advance once per hop, so the time constants are converted to frames
+    auto const frameCoef = [this] (float ms)
+    {
+        double const frames = juce::jmax(1.0e-3, ms * 0.001 * sampleRate / hopSize);
+        return static_cast<float>(1.0 - std::exp(-1.0 / frames));
+    };
+
+    attackCoef  = frameCoef(attackMs);
+    releaseCoef = frameCoef(releaseMs);
+}
+
+
+void SpectralVocoder::process(float const* const* modulator, int numModChannels,
+                              float const* const* carrier, float* const* output, int numCarChannels,
+                              int numSamples, float modGain)
+{
+    int const mask = fftSize - 1;
+
+    for(int i = 0; i < numSamples; i++)
+    {
+        for(int channel = 0; channel < numModChannels; channel++){modInput[channel][position] = modulator[channel][i];}
+        for(int channel = 0; channel < numCarChannels; channel++){carInput[channel][position] = carrier[channel][i];}
+
+        //The inputs of this sample are stored, so the output may now overwrite them
+        for(int channel = 0; channel < numCarChannels; channel++)
+        {
+            output[channel][i] = outputSum[channel][position];
+            outputSum[channel][position] = 0.f;
+        }
+
+        position = (position + 1) & mask;
+
+        if (++hopCounter == hopSize)
+        {
+            hopCounter = 0;
+            processFrame(numModChannels, numCarChannels, modGain);
+        }
+    }
+}
+
+
+void SpectralVocoder::loadFrame(std::vector<float> const& input)
+{
+    int const mask = fftSize - 1;
+
+    //position is the oldest sample of the history
+    for(int k = 0; k < fftSize; k++){frame[k] = input[(position + k) & mask] * window[k];}
+
+    std::fill(frame.begin() + fftSize, frame.end(), 0.f);
+}
+
+
+void SpectralVocoder::processFrame(int numModChannels, int numCarChannels, float modGain)
+{
+    int const mask = fftSize - 1;
+
+    //Modulator: band energies, averaged over the channels
+    std::fill(bandEnergy.begin(), bandEnergy.begin() + numBands, 0.f);
+
+    for(int channel = 0; channel < numModChannels; channel++)
+    {
+        loadFrame(modInput[channel]);
+        fft->performRealOnlyForwardTransform(frame.data(), true);
+
+        for(int k = 0; k < numBins; k++)
+        {
+            if (binBand[k] < 0){continue;}
+            bandEnergy[binBand[k]] += frame[2 * k] * frame[2 * k] + frame[2 * k + 1] * frame[2 * k + 1];
+        }
+    }
+
+    float const channelScale = energyScale / static_cast<float>(numModChannels);
+
+    for(int band = 0; band < numBands; band++)
+    {
+        float const meanSquare = bandEnergy[band] * channelScale;
+        float const coef = meanSquare > envelope[band] ? attackCoef : releaseCoef;
+        envelope[band] += coef * (meanSquare - envelope[band]);
+    }
+
+    for(int k = 0; k < numBins; k++)
+    {
+        binGain[k] = binBand[k] < 0 ? 0.f : modGain * std::sqrt(envelope[binBand[k]]);
+    }
+
+    //Carrier: weight every bin by the envelope of its band and overlap-add the frame
+    for(int channel = 0; channel < numCarChannels; channel++)
+    {
+        loadFrame(carInput[channel]);
+        fft->performRealOnlyForwardTransform(frame.data(), true);
+
+        for(int k = 0; k < numBins; k++)
+        {
+            frame[2 * k]     *= binGain[k];
+            frame[2 * k + 1] *= binGain[k];
+        }
+
+        fft->performRealOnlyInverseTransform(frame.data());
+
+        auto& sum = outputSum[channel];
+
+        for(int k = 0; k < fftSize; k++){sum[(position + k) & mask] += frame[k] * window[k] * overlapScale;}
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterBank.h"
+
+//==============================================================================
+/**
+    Vocoder working on short-time spectra instead of a filter bank, for band counts the
+    biquads cannot afford.
+
+    Modulator and carrier are cut into Hann-windowed frames with 75% overlap. Every frame
+    measures the RMS of each modulator band from its spectrum, smooths it with the attack
+    and release times at the frame rate, scales the carrier bins of that band by it and
+    overlap-adds the result. Bands narrower than an FFT bin collapse into per-bin
+    envelopes. The cost per sample depends on the FFT size only, not on the band count.
+
+    The output is delayed by exactly getLatencySamples().
+*/
+class SpectralVocoder
+{
+
+public:
+
+    int constexpr static maxChannels = FilterBank::maxChannels;
+
+
+    /** Picks the FFT size for the sample rate and allocates everything. Not realtime safe. */
+    void prepare(double sampleRate);
+
+    /** Clears the frame history and the envelopes. */
+    void reset();
+
+    /** Maps the spectral band edges of the design onto FFT bins. Realtime safe. */
+    void setBands(FilterBankDesign const& design);
+
+    void setEnvelope(float attackMs, float releaseMs);
+
+    int getLatencySamples() const { return fftSize; }
+
+    int getNumBands() const { return numBands; }
+
+    /** The modulator level a band has reached, before modGain. */
+    float getBandLevel(int band) const { return std::sqrt(envelope[static_cast<size_t>(band)]); }
+
+
+    /** Same contract as FilterBank::process(): the output may alias the modulator or carrier. */
+    void process(float const* const* modulator, int numModChannels,
+                 float const* const* carrier, float* const* output, int numCarChannels,
+                 int numSamples, float modGain);
+
+
+private:
+
+    double sampleRate{44100.0};
+
+    int fftSize{};
+    int hopSize{};
+    int numBins{};
+    int numBands{};
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+
+    std::vector<float> window;
+    float energyScale{};
+    float overlapScale{};
+
+    //Circular histories of the last fftSize samples, and the overlap-add accumulators
+    std::array<std::vector<float>, maxChannels> modInput, carInput, outputSum;
+    int position{};
+    int hopCounter{};
+
+    //Interleaved complex spectrum of one frame, as juce::dsp::FFT expects it
+    std::vector<float> frame;
+
+    std::vector<int>   binBand;
+    std::vector<float> binGain;
+    std::array<float, FilterBankDesign::maxSpectralBands> bandEnergy{};
+    std::array<float, FilterBankDesign::maxSpectralBands> envelope{};
+
+    float attackCoef{1.f};
+    float releaseCoef{1.f};
+
+
+    void loadFrame(std::vector<float> const& input);
+    void processFrame(int numModChannels, int numCarChannels, float modGain);
+};
@@ -0,0 +1,483 @@
+#include "VocoderEngine.h"
+
+void VocoderEngine::prepare(double newSampleRate, int maximumBlockSize, int numChannels, BandLayout layout, int oversampling)
+{
+    RealtimeCheck::assertNotRealtime("VocoderEngine::prepare");
+
+    //Half-band stages double the rate each; the order is log2 of the factor
+    size_t const stages = oversampling == oversamplingOff ? 0
+                        : (oversampling == oversampling4x || oversampling == oversampling4xEco) ? 2 : 1;
+
+    oversamplingFactor  = 1 << stages;
+    numPreparedChannels = juce::jlimit(1, FilterBank::maxChannels, numChannels);
+    oversampler.reset();
+    carrierOversampler.reset();
+
+    if (stages > 0)
+    {
+        bool const eco  = oversampling == oversampling2xEco || oversampling == oversampling4xEco;
+        auto const type = eco ? juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR
+                              : juce::dsp::Oversampling<float>::filterHalfBandFIREquiripple;
+
+        for (auto* stage : { &oversampler, &carrierOversampler })
+        {
+            stage->reset(new juce::dsp::Oversampling<float>(static_cast<size_t>(numPreparedChannels), stages, type, ! eco));
+            (*stage)->initProcessing(static_cast<size_t>(subBlockSize));
+        }
+    }
+
+    //Everything past this point runs at the inner rate, one sub-block at a time
+    juce::ignoreUnused(maximumBlockSize);
+
+    newSampleRate *= oversamplingFactor;
+    int const maxInnerBlock = subBlockSize * oversamplingFactor;
+
+    sampleRate = newSampleRate;
+
+    oscOutput.setSize(1, maxInnerBlock);
+    modDownmix.setSize(1, maxInnerBlock);
+    partials.setSize(FilterBank::maxPartitions * FilterBank::maxChannels, maxInnerBlock);
+
+    filterBank.reset();
+    multirateBank.prepare(newSampleRate, maxInnerBlock);
+
+    if (sharedGroup.load() != nullptr){sharedGroup = SharedAnalysis::getGroup(newSampleRate);}
+    spectralVocoder.prepare(newSampleRate);
+    activeMode = filterBankMode;
+
+    setBandLayout(layout);
+
+    if (auto const* design = coefficientPipeline.acquire())
+    {
+        filterBank.setDesign(*design);
+        multirateBank.setDesign(*design);
+        spectralVocoder.setBands(*design);
+    }
+
+    osc_.prepare(newSampleRate);
+    voices.prepare(newSampleRate);
+    meter.prepare(newSampleRate);
+    activeCarrier = oscillatorCarrier;
+}
+
+
+void VocoderEngine::setBandLayout(BandLayout layout)
+{
+    RealtimeCheck::assertNotRealtime("VocoderEngine::setBandLayout");
+
+    auto design = getBandDesign(layout);
+
+    const juce::ScopedLock lock(layoutLock);
+
+    coefficientPipeline.publish(design->getDesign());
+    layoutDesign = design;
+}
+
+
+DesignCache::Entry::Ptr VocoderEngine::getBandDesign(BandLayout layout) const
+{
+    RealtimeCheck::assertNotRealtime("VocoderEngine::getBandDesign");
+
+    layout.sampleRate = sampleRate.load();
+    return DesignCache::get(layout);
+}
+
+
+double VocoderEngine::getTailLengthSeconds(BandLayout const& layout, float releaseMs, int detector)
+{
+    //Time constants for an exponential decay to reach silenceLevel
+    auto const timeConstants = -std::log(static_cast<double>(FilterBank::silenceLevel));
+
+    //The rms detector releases the squared level, so the level itself falls half as fast
+    auto const release = releaseMs * 0.001 * (detector == 0 ? 2.0 : 1.0);
+
+    //A band-pass at f with quality q decays with a time constant of q / (pi f); the slowest
+    //pole of a Butterworth cascade of n sections is 1 / sin(pi / 2n) times slower still
+    auto const sections = juce::jlimit(1, BandCascade::maxSections, layout.numSections);
+    auto const ringOut  = layout.q / (juce::MathConstants<double>::pi * juce::jmax(1.f, layout.lowFreq))
+                        / std::sin(juce::MathConstants<double>::pi / (2 * sections));
+
+    return (release + ringOut) * timeConstants;
+}
+
+
+void VocoderEngine::createWorkerPool()
+{
+    RealtimeCheck::assertNotRealtime("VocoderEngine::createWorkerPool");
+
+    const juce::ScopedLock lock(poolCreationLock);
+
+    if (activePool.load() != nullptr){return;}
+
+    //The calling thread always takes part, so one worker fewer than partitions is enough
+    auto const numWorkers = juce::jmin(juce::SystemStats::getNumCpus() - 1, FilterBank::maxPartitions - 1);
+    activePool = BandWorkerPool::acquire(numWorkers);
+}
+
+
+void VocoderEngine::releaseWorkerPool()
+{
+    RealtimeCheck::assertNotRealtime("VocoderEngine::releaseWorkerPool");
+
+    const juce::ScopedLock lock(poolCreationLock);
+
+    if (activePool.exchange(nullptr) != nullptr){BandWorkerPool::release();}
+}
+
+
+void VocoderEngine::enableSharedAnalysis()
+{
+    RealtimeCheck::assertNotRealtime("VocoderEngine::enableSharedAnalysis");
+
+    if (sharedGroup.load() == nullptr){sharedGroup = SharedAnalysis::getGroup(sampleRate.load());}
+}
+
+
+void VocoderEngine::process(juce::AudioBuffer<float>& buffer, VocoderParameters const& parameters)
+{
+    process(buffer, noMidi, parameters);
+}
+
+
+void VocoderEngine::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer const& midi, VocoderParameters const& parameters)
+{
+    processBlock(buffer, nullptr, 0, midi, parameters);
+}
+
+
+void VocoderEngine::process(juce::AudioBuffer<float>& buffer, float const* const* carrier, int numCarrierChannels,
+                            VocoderParameters const& parameters)
+{
+    processBlock(buffer, carrier, juce::jlimit(1, FilterBank::maxChannels, numCarrierChannels), noMidi, parameters);
+}
+
+
+void VocoderEngine::processBlock(juce::AudioBuffer<float>& buffer, float const* const* external, int numExternalChannels,
+                                 juce::MidiBuffer const& midi, VocoderParameters const& parameters)
+{
+    int const numSamples = buffer.getNumSamples();
+    if (numSamples == 0){return;}
+
+    AudioThreadProfiler::ScopedStage blockStage (profiler, AudioThreadProfiler::block);
+
+    //Notes held while another carrier was playing are dropped rather than left hanging
+    if (parameters.carrier != activeCarrier)
+    {
+        voices.reset();
+        activeCarrier = parameters.carrier;
+    }
+
+    //Channels past the prepared ones only ever receive a copy of the first output channel
+    int const numChannels = juce::jmin(buffer.getNumChannels(), numPreparedChannels);
+    numExternalChannels   = juce::jmin(numExternalChannels, numPreparedChannels);
+
+    float*       channels[FilterBank::maxChannels] = {};
+    float const* carrier[FilterBank::maxChannels]  = {};
+
+    //Every host block is cut into sub-blocks of the same size, so the stages keep the same
+    //working set and control timing however large, small or irregular the host's blocks are
+    for (int position = 0; position < numSamples; position += subBlockSize)
+    {
+        int const length = juce::jmin(subBlockSize, numSamples - position);
+
+        for (int channel = 0; channel < numChannels; channel++){channels[channel] = buffer.getWritePointer(channel, position);}
+
+        if (external != nullptr)
+        {
+            for (int channel = 0; channel < numExternalChannels; channel++){carrier[channel] = external[channel] + position;}
+        }
+
+        //Refers to the host's channels, so nothing is copied or allocated
+        juce::AudioBuffer<float> subBlock (channels, numChannels, length);
+        auto const* subCarrier = external != nullptr ? carrier : nullptr;
+
+        if (oversampler != nullptr)
+        {
+            processOversampled(subBlock, subCarrier, numExternalChannels, midi, position, parameters);
+        }
+        else
+        {
+            processVocoder(subBlock, subCarrier, numExternalChannels, midi, position, 1, parameters);
+        }
+    }
+
+    for (int channel = numChannels; channel < buffer.getNumChannels(); channel++)
+    {
+        buffer.copyFrom(channel, 0, buffer, 0, 0, numSamples);
+    }
+}
+
+
+void VocoderEngine::processOversampled(juce::AudioBuffer<float>& buffer, float const* const* external, int numExternalChannels,
+                                       juce::MidiBuffer const& midi, int midiStart, VocoderParameters const& parameters)
+{
+    int const numChannels = buffer.getNumChannels();
+
+    juce::dsp::AudioBlock<float> block (buffer);
+    auto upsampled = oversampler->processSamplesUp(block).getSubsetChannelBlock(0, static_cast<size_t>(numChannels));
+
+    //The stages own their buffers, so the inner buffer only refers to them and nothing is allocated
+    float* inner[FilterBank::maxChannels] = {};
+    for (int channel = 0; channel < numChannels; channel++){inner[channel] = upsampled.getChannelPointer(static_cast<size_t>(channel));}
+
+    juce::AudioBuffer<float> innerBuffer (inner, numChannels, static_cast<int>(upsampled.getNumSamples()));
+
+    float const* innerExternal[FilterBank::maxChannels] = {};
+
+    if (external != nullptr)
+    {
+        //processSamplesUp only reads its input; AudioBlock just has no const view
+        juce::dsp::AudioBlock<float> carrierBlock (const_cast<float* const*>(external),
+                                                   static_cast<size_t>(numExternalChannels),
+                                                   static_cast<size_t>(buffer.getNumSamples()));
+        auto carrierUp = carrierOversampler->processSamplesUp(carrierBlock);
+
+        for (int channel = 0; channel < numExternalChannels; channel++)
+        {
+            innerExternal[channel] = carrierUp.getChannelPointer(static_cast<size_t>(channel));
+        }
+    }
+
+    processVocoder(innerBuffer, external != nullptr ? innerExternal : nullptr, numExternalChannels,
+                   midi, midiStart, oversamplingFactor, parameters);
+
+    oversampler->processSamplesDown(block);
+}
+
+
+void VocoderEngine::processVocoder(juce::AudioBuffer<float>& buffer, float const* const* external, int numExternalChannels,
+                                   juce::MidiBuffer const& midi, int midiStart, int midiScale, VocoderParameters const& parameters)
+{
+    int const numSamples  = buffer.getNumSamples();
+    int const numChannels = buffer.getNumChannels();
+
+    //The internal carrier is a single mono lane; an external one brings its own channels
+    float const* generated[FilterBank::maxChannels] = {};
+    int numGenerated = numExternalChannels;
+
+    if (external != nullptr)
+    {
+        for (int channel = 0; channel < numGenerated; channel++){generated[channel] = external[channel];}
+    }
+    else
+    {
+        AudioThreadProfiler::ScopedStage stage (profiler, AudioThreadProfiler::oscillator);
+
+        //All voices are summed into the one carrier lane, so the bank runs once whatever the polyphony
+        if (activeCarrier == midiCarrier)
+        {
+            voices.setWaveform(parameters.oscWave);
+            voices.render(midi, midiStart, oscOutput.getWritePointer(0), numSamples, midiScale);
+        }
+        else
+        {
+            osc_.setWaveform(parameters.oscWave);
+            osc_.setFrequency(parameters.oscFreq);
+            osc_.render(oscOutput.getWritePointer(0), numSamples);
+        }
+
+        generated[0] = oscOutput.getReadPointer(0);
+        numGenerated = 1;
+    }
+
+    int const mode = parameters.mode;
+
+    {
+        AudioThreadProfiler::ScopedStage stage (profiler, AudioThreadProfiler::design);
+
+        //Idle paths have nothing to ramp, so they simply switch to the new design
+        if (auto const* design = coefficientPipeline.acquire())
+        {
+            int const rampLength = designRampSamples * midiScale;
+
+            if (mode == filterBankMode) filterBank.beginRamp(*design, rampLength);
+            else                        filterBank.setDesign(*design);
+
+            if (mode == multirateMode)  multirateBank.beginRamp(*design, rampLength);
+            else                        multirateBank.setDesign(*design);
+
+            spectralVocoder.setBands(*design);
+        }
+    }
+
+    //A mono internal carrier only needs one pass on whichever side it feeds
+    bool const switched    = parameters.switchCarrMod;
+    int  const numBuffer   = juce::jmin(numChannels, FilterBank::maxChannels);
+    int        modChannels = switched ? numGenerated : numBuffer;
+    int  const carChannels = juce::jmin(switched ? numBuffer : numGenerated, numBuffer);
+
+    float const* modPointers[FilterBank::maxChannels] = {};
+    float const* carPointers[FilterBank::maxChannels] = {};
+    float*       outPointers[FilterBank::maxChannels] = {};
+
+    for (int channel = 0; channel < modChannels; channel++)
+    {
+        modPointers[channel] = switched ? generated[channel] : buffer.getReadPointer(channel);
+    }
+
+    for (int channel = 0; channel < carChannels; channel++)
+    {
+        carPointers[channel] = switched ? buffer.getReadPointer(channel) : generated[channel];
+        outPointers[channel] = buffer.getWritePointer(channel);
+    }
+
+    //Linked analysis follows the envelopes of the downmix, so every carrier channel gets the same
+    //gains from a single pass over the modulator
+    if (parameters.linkedAnalysis && modChannels > 1)
+    {
+        auto* downmix    = modDownmix.getWritePointer(0);
+        auto const scale = 1.f / static_cast<float>(modChannels);
+
+        juce::FloatVectorOperations::copyWithMultiply(downmix, modPointers[0], scale, numSamples);
+
+        for (int channel = 1; channel < modChannels; channel++)
+            juce::FloatVectorOperations::addWithMultiply(downmix, modPointers[channel], scale, numSamples);
+
+        modPointers[0] = downmix;
+        modChannels    = 1;
+    }
+
+    //Whichever path takes over starts from silence rather than from state left over from its last use
+    if (mode != activeMode)
+    {
+        if      (mode == spectralMode)  spectralVocoder.reset();
+        else if (mode == multirateMode) multirateBank.reset();
+        else                            filterBank.reset();
+
+        activeMode = mode;
+    }
+
+    auto const detector = parameters.detector == 0 ? FilterBank::Detector::rms : FilterBank::Detector::peak;
+
+    {
+        AudioThreadProfiler::ScopedStage stage (profiler, AudioThreadProfiler::vocoder);
+
+        if (mode == spectralMode)
+        {
+            spectralVocoder.setEnvelope(parameters.attack, parameters.release);
+            spectralVocoder.process(modPointers, modChannels, carPointers, outPointers, carChannels, numSamples, parameters.rmsGain);
+        }
+        else if (mode == multirateMode)
+        {
+            multirateBank.setEnvelope(parameters.attack, parameters.release, detector);
+            multirateBank.process(modPointers, modChannels, carPointers, outPointers, carChannels, numSamples, parameters.rmsGain);
+        }
+        else
+        {
+            processFilterBank(modPointers, modChannels, carPointers, outPointers, carChannels, numSamples, parameters);
+        }
+
+        if (meter.advance(numSamples))
+        {
+            if (mode == spectralMode)
+                meter.push(spectralVocoder.getNumBands(), [this, &parameters] (int band) { return parameters.rmsGain * spectralVocoder.getBandLevel(band); });
+            else if (mode == multirateMode)
+                meter.push(multirateBank.getNumBands(), [this] (int band) { return multirateBank.getBandGain(band); });
+            else
+                meter.push(filterBank.getNumBands(), [this] (int band) { return filterBank.getBandGain(band); });
+        }
+    }
+
+    AudioThreadProfiler::ScopedStage stage (profiler, AudioThreadProfiler::mix);
+
+    for (int channel = carChannels; channel < numChannels; channel++)
+    {
+        buffer.copyFrom(channel, 0, buffer, 0, 0, numSamples);
+    }
+
+    if (parameters.bypassMod)
+    {
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            buffer.copyFrom(channel, 0, generated[juce::jmin(channel, numGenerated - 1)], numSamples);
+        }
+    }
+
+    buffer.applyGain(parameters.outGain);
+}
+
+
+void VocoderEngine::processFilterBank(float const* const* modulator, int numModChannels,
+                                      float const* const* carrier, float* const* output, int numCarChannels,
+                                      int numSamples, VocoderParameters const& parameters)
+{
+    //Follow the envelope of every modulator band and apply it to the matching carrier band,
+    //reading the modulator and carrier and writing the output in a single pass
+    filterBank.setEnvelope(sampleRate.load(), parameters.attack, parameters.release,
+                           parameters.detector == 0 ? FilterBank::Detector::rms : FilterBank::Detector::peak);
+
+    auto* pool = parameters.multiCore ? activePool.load() : nullptr;
+
+    bool const parallel = pool != nullptr
+                       && numSamples <= partials.getNumSamples()
+                       && filterBank.getNumPartitions() > 1
+                       && (parameters.nonRealtime || filterBank.getNumBands() >= parallelMinBands);
+
+    auto* group = parameters.sharedAnalysis ? sharedGroup.load() : nullptr;
+
+    if (parallel)
+    {
+        processParallel(*pool, modulator, numModChannels, carrier, output, numCarChannels, numSamples, parameters.rmsGain);
+    }
+    else if (group != nullptr && ! filterBank.isRamping())
+    {
+        //Whichever engine gets to a block first analyses it; the others only synthesise
+        auto const key = filterBank.getAnalysisKey(modulator, numModChannels, numSamples);
+
+        if (group->read(this, key, analysisFrame))
+        {
+            filterBank.follow(analysisFrame, modulator, numModChannels, carrier, output, numCarChannels, numSamples, parameters.rmsGain);
+        }
+        else
+        {
+            filterBank.process(modulator, numModChannels, carrier, output, numCarChannels, numSamples, parameters.rmsGain, analysisFrame);
+            group->publish(this, key, analysisFrame);
+        }
+    }
+    else
+    {
+        filterBank.process(modulator, numModChannels, carrier, output, numCarChannels, numSamples, parameters.rmsGain);
+    }
+}
+
+
+void VocoderEngine::processParallel(BandWorkerPool& pool, float const* const* modulator, int numModChannels,
+                                    float const* const* carrier, float* const* output, int numCarChannels,
+                                    int numSamples, float modGain)
+{
+    struct Job
+    {
+        FilterBank* bank;
+        float const* const* modulator;
+        float const* const* carrier;
+        int numModChannels, numCarChannels, numSamples;
+        float modGain;
+        float* partials[FilterBank::maxPartitions][FilterBank::maxChannels];
+    };
+
+    //The output may alias the modulator or carrier, so no partition writes it directly
+    Job job { &filterBank, modulator, carrier, numModChannels, numCarChannels, numSamples, modGain, {} };
+    int const numPartitions = filterBank.getNumPartitions();
+
+    for (int p = 0; p < numPartitions; p++)
+    {
+        for (int channel = 0; channel < numCarChannels; channel++)
+            job.partials[p][channel] = partials.getWritePointer(p * FilterBank::maxChannels + channel);
+    }
+
+    pool.run(numPartitions, [] (void* context, int p)
+    {
+        auto& j = *static_cast<Job*>(context);
+        j.bank->processPartitions(p, p + 1, j.modulator, j.numModChannels, j.carrier, j.partials[p], j.numCarChannels, j.numSamples, j.modGain);
+    }, &job);
+
+    filterBank.endBlock(numSamples);
+
+    for (int channel = 0; channel < numCarChannels; channel++)
+    {
+        juce::FloatVectorOperations::copy(output[channel], job.partials[0][channel], numSamples);
+
+        for (int p = 1; p < numPartitions; p++)
+            juce::FloatVectorOperations::add(output[channel], job.partials[p][channel], numSamples);
+    }
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Oscillator.h"
+#include "VoicePool.h"
+#include "BandMeter.h"
+#include "FilterBank.h"
+#include "MultirateFilterBank.h"
+#include "SpectralVocoder.h"
+#include "SharedAnalysis.h"
+#include "CoefficientPipeline.h"
+#include "DesignCache.h"
+#include "BandWorkerPool.h"
+#include "AudioThreadProfiler.h"
+#include "RealtimeCheck.h"
+
+//==============================================================================
+/** Per-block settings of the engine; mirrors the plugin parameters of the same name. */
+struct VocoderParameters
+{
+    float oscFreq{100.f};
+    int   oscWave{1};
+    float rmsGain{2.f};
+    float attack{5.f};
+    float release{50.f};
+    int   detector{0};
+    bool  switchCarrMod{false};
+    bool  bypassMod{false};
+    float outGain{2.f};
+
+    /** Selects the filter bank, the FFT-based spectral vocoder or the multirate filter bank,
+        see VocoderEngine::Mode. */
+    int   mode{0};
+
+    /** 0 renders the internal oscillator at oscFreq, 1 plays the MIDI voice pool and 2 asks
+        for an external carrier, see VocoderEngine::Carrier. */
+    int   carrier{0};
+
+    /** Analyses a downmix of the modulator channels once instead of every channel, so the
+        analysis cost stays flat however many channels a surround layout has. */
+    bool  linkedAnalysis{false};
+
+    /** Allows splitting the plain filter bank across the worker pool; it is only used for
+        offline renders or when enough bands are active to pay for the hand-off. */
+    bool  multiCore{false};
+    bool  nonRealtime{false};
+
+    /** Lets the filter bank replay the analysis of another engine fed the same modulator
+        with the same settings instead of running its own, see SharedAnalysis. */
+    bool  sharedAnalysis{false};
+};
+
+
+//==============================================================================
+/**
+    The vocoder DSP without the plugin around it, so hosts, offline renderers and
+    benchmarks all run exactly the same code.
+
+    The band layout is designed on the calling thread by setBandLayout() and picked
+    up by the next process() call; everything else arrives with VocoderParameters.
+*/
+class VocoderEngine : public SIMDAligned
+{
+public:
+
+    ~VocoderEngine() { releaseWorkerPool(); }
+
+    enum Mode
+    {
+        filterBankMode,
+        spectralMode,
+        multirateMode
+    };
+
+    /** The sidechain carrier is passed to process() by the caller; without one the
+        engine falls back to the oscillator. */
+    enum Carrier
+    {
+        oscillatorCarrier,
+        midiCarrier,
+        sidechainCarrier
+    };
+
+    /** Runs the oscillator and carrier bank at two or four times the host rate. The eco
+        settings use polyphase IIR half-bands: cheaper and shorter, but not linear phase. */
+    enum Oversampling
+    {
+        oversamplingOff,
+        oversampling2x,
+        oversampling2xEco,
+        oversampling4x,
+        oversampling4xEco
+    };
+
+
+    /** Resets all state and switches to the given layout immediately. Every oversampling
+        buffer is allocated here, so changing the setting means preparing again. Scratch
+        buffers are sized for subBlockSize, so process() takes blocks of any length whatever
+        maximumBlockSize says. The oversampling stages are built for numChannels, the most
+        channels the buffer or an external carrier will bring; channels past it are not
+        vocoded and receive a copy of the first output channel. */
+    void prepare(double sampleRate, int maximumBlockSize, int numChannels, BandLayout layout, int oversampling = oversamplingOff);
+
+    /** Looks up or designs the filters for a new layout and queues them for the audio thread,
+        which ramps to them. layout.sampleRate is ignored. Never call from process(). */
+    void setBandLayout(BandLayout layout);
+
+    /** The shared design of a layout at the current rate, without publishing it; holding it
+        keeps it in DesignCache for a later setBandLayout(). Never call from process(). */
+    DesignCache::Entry::Ptr getBandDesign(BandLayout layout) const;
+
+    /** Vocodes the buffer in place: its channels are the modulator (or the carrier, if
+        switchCarrMod is set) and receive the output. */
+    void process(juce::AudioBuffer<float>& buffer, VocoderParameters const& parameters);
+
+    /** As above; with the MIDI carrier selected, notes in midi play the voice pool
+        at their sample positions. */
+    void process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer const& midi, VocoderParameters const& parameters);
+
+    /** As above, but the carrier comes from outside instead of the oscillator or voices;
+        its channels must hold at least as many samples as the buffer and may not alias it. */
+    void process(juce::AudioBuffer<float>& buffer, float const* const* carrier, int numCarrierChannels,
+                 VocoderParameters const& parameters);
+
+    /** Joins the process-wide worker threads used when VocoderParameters::multiCore is set,
+        starting them if no other engine has. Does nothing if already joined. Call from any
+        thread except the audio thread. */
+    void createWorkerPool();
+
+    /** Leaves the worker threads again; they stop once no engine uses them. process() must
+        not be running, so a plugin suspends processing around this. */
+    void releaseWorkerPool();
+
+    bool hasWorkerPool() const { return activePool.load() != nullptr; }
+
+    /** Joins the SharedAnalysis group of the current rate, which VocoderParameters::sharedAnalysis
+        needs to take effect; prepare() moves to the group of a new rate. Does nothing if already
+        joined. Call from any thread except the audio thread. */
+    void enableSharedAnalysis();
+
+    /** Stage timings of process(); readable from any thread. */
+    AudioThreadProfiler& getProfiler() { return profiler; }
+
+    /** Band levels of the active mode, sent while the meter is switched on. */
+    BandMeter& getBandMeter() { return meter; }
+
+    /** The rate the bank runs at, which is the host rate times the oversampling factor. */
+    double getSampleRate() const  { return sampleRate.load(); }
+    int getNumActiveBands() const { return filterBank.getNumBands(); }
+    int getNumActiveVoices() const { return voices.getNumVoices(); }
+
+    /** The delay of the output for the given mode in host samples; the plain filter bank
+        only has the oversampling filters'. Valid after prepare(). */
+    int getLatencySamples(int mode) const
+    {
+        int inner = 0;
+        if (mode == spectralMode)  inner = spectralVocoder.getLatencySamples();
+        if (mode == multirateMode) inner = multirateBank.getLatencySamples();
+
+        if (oversampler == nullptr){return inner;}
+        return juce::roundToInt(oversampler->getLatencyInSamples() + static_cast<float>(inner) / oversamplingFactor);
+    }
+
+    /** How long the output keeps sounding after the modulator stops: the envelope release
+        down to FilterBank::silenceLevel plus the ring-out of the lowest band. */
+    static double getTailLengthSeconds(BandLayout const& layout, float releaseMs, int detector);
+
+    /** Below this many active bands realtime blocks stay on the calling thread. */
+    int constexpr static parallelMinBands = 24;
+
+    /** Host blocks are processed in pieces of this many samples, so the working set and the
+        timing of the envelopes and coefficient updates do not depend on the host's block size. */
+    int constexpr static subBlockSize = 64;
+
+    /** New band designs are ramped to over this many host samples. */
+    int constexpr static designRampSamples = 8 * subBlockSize;
+
+private:
+
+    std::atomic<double> sampleRate{44100.0};
+
+    AudioThreadProfiler profiler;
+    BandMeter meter;
+
+    FilterBank filterBank;
+    CoefficientPipeline coefficientPipeline;
+
+    //Keeps the current layout's design in the cache for other engines with the same settings
+    DesignCache::Entry::Ptr layoutDesign;
+    juce::CriticalSection layoutLock;
+
+    MultirateFilterBank multirateBank;
+    SpectralVocoder spectralVocoder;
+    int activeMode{filterBankMode};
+
+    juce::AudioBuffer<float> oscOutput;
+    juce::AudioBuffer<float> modDownmix;
+    Oscillator osc_;
+    VoicePool voices;
+    int activeCarrier{oscillatorCarrier};
+    juce::MidiBuffer noMidi;
+
+    //Separate stages for the main buffer and an external carrier, since each keeps filter state
+    std::unique_ptr<juce::dsp::Oversampling<float>> oversampler;
+    std::unique_ptr<juce::dsp::Oversampling<float>> carrierOversampler;
+    int oversamplingFactor{1};
+    int numPreparedChannels{FilterBank::maxChannels};
+
+    std::atomic<BandWorkerPool*> activePool{nullptr};
+    juce::CriticalSection poolCreationLock;
+
+    //One carrier sum per partition and channel, added together in partition order
+    juce::AudioBuffer<float> partials;
+
+    std::atomic<SharedAnalysis::Group*> sharedGroup{nullptr};
+    AnalysisFrame analysisFrame;
+
+    void processBlock(juce::AudioBuffer<float>& buffer, float const* const* external, int numExternalChannels,
+                      juce::MidiBuffer const& midi, VocoderParameters const& parameters);
+
+    void processOversampled(juce::AudioBuffer<float>& buffer, float const* const* external, int numExternalChannels,
+                            juce::MidiBuffer const& midi, int midiStart, VocoderParameters const& parameters);
+
+    void processVocoder(juce::AudioBuffer<float>& buffer, float const* const* external, int numExternalChannels,
+                        juce::MidiBuffer const& midi, int midiStart, int midiScale, VocoderParameters const& parameters);
+
+    void processFilterBank(float const* const* modulator, int numModChannels,
+                           float const* const* carrier, float* const* output, int numCarChannels,
+                           int numSamples, VocoderParameters const& parameters);
+
+    void processParallel(BandWorkerPool& pool, float const* const* modulator, int numModChannels,
+                         float const* const* carrier, float* const* output, int numCarChannels,
+                         int numSamples, float modGain);
+};
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Oscillator.h"
+#include "SIMDAligned.h"
+
+//==============================================================================
+/**
+    Polyphonic MIDI carrier: a fixed pool of wavetable voices summed into one mono
+    signal, so the filter bank runs once however many notes are held.
+
+    Voice state is kept as parallel arrays with the sounding voices packed at the front.
+    Each voice renders its span a SIMD vector of consecutive samples at a time, into one
+    mix that every voice adds to.
+    Nothing is allocated after construction; when all voices are busy a new note
+    steals the oldest released voice, or else the oldest voice. Only the gain glides
+    from wherever it was: pitch and wavetable switch at once. The phase carries on, so
+    the signal itself does not jump, but a loud stolen voice audibly changes pitch.
+*/
+class VoicePool : public SIMDAligned
+{
+
+public:
+
+    int constexpr static maxVoices = 16;
+
+
+    VoicePool()
+    : tables(WaveTables::get())
+    {
+        reset();
+    }
+
+
+    void prepare(double sampleRate)
+    {
+        sampleRate_    = sampleRate;
+        attackSamples  = juce::jmax(1, static_cast<int>(attackSeconds * sampleRate));
+        releaseSamples = juce::jmax(1, static_cast<int>(releaseSeconds * sampleRate));
+        reset();
+    }
+
+
+    /** Silences every voice at once. */
+    void reset()
+    {
+        numVoices = 0;
+    }
+
+
+    /** 0 = sine, 1 = saw, 2 = square, 3 = triangle; sounding voices switch immediately. */
+    void setWaveform(int w)
+    {
+        w = juce::jlimit(0, WaveTables::numWaveforms - 1, w);
+        if (w == waveform){return;}
+
+        waveform = w;
+        for(int v = 0; v < numVoices; v++){table[v] = tables.getTable(waveform, level[v]);}
+    }
+
+
+    int getNumVoices() const { return numVoices; }
+
+
+    void noteOn(int noteNumber, float velocity)
+    {
+        int v = findVoice(noteNumber);
+
+        if (v < 0)
+        {
+            bool const fresh = numVoices < maxVoices;
+            v = fresh ? numVoices++ : findVoiceToSteal();
+
+            auto const frequency = static_cast<float>(juce::MidiMessage::getMidiNoteInHertz(noteNumber));
+            auto const cycles    = juce::jlimit(0.0, 0.5, frequency / sampleRate_);
+
+            note[v]      = noteNumber;
+            increment[v] = static_cast<uint32_t>(cycles * 4294967296.0);
+            level[v]     = WaveTables::getLevel(sampleRate_, frequency);
+            table[v]     = tables.getTable(waveform, level[v]);
+
+            //A fresh voice starts silent; a stolen one keeps its phase and glides from its current gain
+            if (fresh){gain[v] = 0.f; phase[v] = 0;}
+        }
+
+        held[v] = true;
+        age[v]  = ++clock;
+        rampTo(v, velocity * voiceGain, attackSamples);
+    }
+
+
+    void noteOff(int noteNumber)
+    {
+        for(int v = 0; v < numVoices; v++)
+        {
+            if (note[v] == noteNumber && held[v])
+            {
+                held[v] = false;
+                rampTo(v, 0.f, releaseSamples);
+            }
+        }
+    }
+
+
+    void allNotesOff()
+    {
+        for(int v = 0; v < numVoices; v++)
+        {
+            held[v] = false;
+            rampTo(v, 0.f, releaseSamples);
+        }
+    }
+
+
+    /** Renders the sum of all voices into output, replacing its contents, and applies
+        note on/off and all-notes-off messages at their sample positions. output starts at
+        host sample startSample of the block midi belongs to; events at or after its end are
+        left for the call that renders them. When the voices run oversampled, positionScale
+        maps host sample positions onto the inner rate. */
+    void render(juce::MidiBuffer const& midi, int startSample, float* output, int numSamples, int positionScale = 1)
+    {
+        int position = 0;
+
+        //Renders up to the event and applies it; false once the event belongs to a later call
+        auto const play = [&] (juce::uint8 const* data, int numBytes, int samplePosition)
+        {
+            auto const eventPosition = (samplePosition - startSample) * positionScale;
+            if (eventPosition >= numSamples){return false;}
+
+            auto const until = juce::jmax(position, eventPosition);
+            renderVoices(output + position, until - position);
+            position = until;
+
+            handleMidiEvent(data, numBytes);
+            return true;
+        };
+
+       #if JUCE_MAJOR_VERSION >= 6
+        for (auto it = midi.findNextSamplePosition(startSample); it != midi.cend(); ++it)
+        {
+            auto const event = *it;
+            if (! play(event.data, event.numBytes, event.samplePosition)){break;}
+        }
+       #else
+        //The only way through a MidiBuffer before JUCE 6; its raw form never builds a MidiMessage, so it cannot allocate
+        juce::MidiBuffer::Iterator iterator (midi);
+        juce::uint8 const* data = nullptr;
+        int numBytes = 0, samplePosition = 0;
+
+        iterator.setNextSamplePosition(startSample);
+        while (iterator.getNextEvent(data, numBytes, samplePosition) && play(data, numBytes, samplePosition)){}
+       #endif
+
+        renderVoices(output + position, numSamples - position);
+    }
+
+
+private:
+
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    int constexpr static lanes   = static_cast<int>(Vec::SIMDNumElements);
+    int constexpr static maxSpan = 256;
+
+    int constexpr static fractionBits      = 32 - WaveTables::waveTableBits;
+    uint32_t constexpr static fractionMask = (1u << fractionBits) - 1u;
+    float constexpr static fractionScale   = 1.f / static_cast<float>(1u << fractionBits);
+
+    double constexpr static attackSeconds  = 0.002;
+    double constexpr static releaseSeconds = 0.05;
+
+    //Keeps a full chord in the same range as the single oscillator
+    float constexpr static voiceGain = 0.5f;
+
+    WaveTables const& tables;
+    double sampleRate_{44100};
+    int    waveform{1};
+    int    attackSamples{1};
+    int    releaseSamples{1};
+
+    //Sounding voices occupy [0, numVoices)
+    int      numVoices{};
+    uint32_t clock{};
+
+    std::array<int, maxVoices>          note{}, level{}, rampLeft{};
+    std::array<bool, maxVoices>         held{};
+    std::array<uint32_t, maxVoices>     phase{}, increment{}, age{};
+    std::array<float, maxVoices>        gain{}, gainStep{}, gainTarget{};
+    std::array<float const*, maxVoices> table{};
+
+    //One voice's table reads for a span, and the sum of all voices over it
+    alignas(sizeof(Vec)) std::array<float, maxSpan> base{}, slope{}, fraction{}, mix{};
+
+
+    int findVoice(int noteNumber) const
+    {
+        for(int v = 0; v < numVoices; v++){if (note[v] == noteNumber){return v;}}
+        return -1;
+    }
+
+
+    int findVoiceToSteal() const
+    {
+        int oldest = 0, oldestReleased = -1;
+
+        for(int v = 0; v < numVoices; v++)
+        {
+            if (age[v] < age[oldest]){oldest = v;}
+            if (! held[v] && (oldestReleased < 0 || age[v] < age[oldestReleased])){oldestReleased = v;}
+        }
+
+        return oldestReleased >= 0 ? oldestReleased : oldest;
+    }
+
+
+    void rampTo(int v, float target, int numSamples)
+    {
+        gainTarget[v] = target;
+        gainStep[v]   = (target - gain[v]) / static_cast<float>(numSamples);
+        rampLeft[v]   = numSamples;
+    }
+
+
+    void handleMidiEvent(juce::uint8 const* data, int numBytes)
+    {
+        if (numBytes < 3){return;}
+
+        auto const status = data[0] & 0xf0;
+
+        if      (status == 0x90 && data[2] > 0)                 noteOn(data[1], data[2] / 127.f);
+        else if (status == 0x80 || status == 0x90)              noteOff(data[1]);
+        else if (status == 0xb0 && (data[1] == 120 || data[1] == 123)) allNotesOff();
+    }
+
+
+    void renderVoices(float* output, int numSamples)
+    {
+        for(int start = 0; start < numSamples; start += maxSpan)
+        {
+            auto const n = juce::jmin(maxSpan, numSamples - start);
+            renderSpan(n);
+
+            juce::FloatVectorOperations::copy(output + start, mix.data(), n);
+        }
+
+        //Voices whose release has finished leave the pack; the last voice takes their slot
+        for(int v = numVoices - 1; v >= 0; v--)
+        {
+            if (! held[v] && rampLeft[v] == 0 && gain[v] == 0.f){removeVoice(v);}
+        }
+    }
+
+
+    /** Sums every voice into mix[0, numSamples). Each voice's table reads go into base, slope
+        and fraction first; the interpolation, the gain and the sum then run a whole vector of
+        consecutive samples at a time. */
+    void renderSpan(int numSamples)
+    {
+        int const numVecs  = (numSamples + lanes - 1) / lanes;
+        auto const offsets = laneOffsets();
+
+        std::fill(mix.begin(), mix.begin() + numVecs * lanes, 0.f);
+
+        for(int v = 0; v < numVoices; v++)
+        {
+            auto const* t  = table[v];
+            auto const inc = increment[v];
+
+            //The padding lanes past numSamples are read but never reach the output
+            readTable(t, phase[v], inc, numVecs * lanes);
+            phase[v] += inc * static_cast<uint32_t>(numSamples);
+
+            //Gain ramp first, then a constant gain for the rest of the span; the ramp is
+            //evaluated per lane and held at its target once it gets there
+            int const numRamp = juce::jmin(rampLeft[v], numSamples);
+            auto const g      = gain[v];
+            auto const step   = gainStep[v];
+            auto const target = Vec::expand(gainTarget[v]);
+
+            for(int j = 0; j < numVecs; j++)
+            {
+                auto const k = static_cast<size_t>(j * lanes);
+
+                auto amplitude = Vec::expand(g);
+
+                if (numRamp > 0)
+                {
+                    amplitude = amplitude + (offsets + Vec::expand(static_cast<float>(j * lanes + 1))) * step;
+                    amplitude = step > 0.f ? Vec::min(amplitude, target) : Vec::max(amplitude, target);
+                }
+
+                auto const wave = Vec::fromRawArray(base.data() + k) + Vec::fromRawArray(fraction.data() + k) * Vec::fromRawArray(slope.data() + k);
+                (Vec::fromRawArray(mix.data() + k) + wave * amplitude).copyToRawArray(mix.data() + k);
+            }
+
+            gain[v]      = numRamp == rampLeft[v] ? gainTarget[v] : g + step * static_cast<float>(numRamp);
+            rampLeft[v] -= numRamp;
+        }
+    }
+
+
+    /** Fills base, slope and fraction for count consecutive samples of table t from phase p
+        on: the entry below each phase, the step to the next one and the position between. */
+    void readTable(float const* t, uint32_t p, uint32_t inc, int count)
+    {
+       #if JUCE_USE_SSE_INTRINSICS
+        //Four phases at a time in SSE2; only the table reads themselves stay scalar
+        static_assert(lanes % 4 == 0, "count is padded to whole vectors, so it must hold whole groups of four");
+
+        auto phases      = _mm_setr_epi32(static_cast<int>(p), static_cast<int>(p + inc),
+                                          static_cast<int>(p + 2 * inc), static_cast<int>(p + 3 * inc));
+        auto const step  = _mm_set1_epi32(static_cast<int>(4 * inc));
+        auto const mask  = _mm_set1_epi32(static_cast<int>(fractionMask));
+        auto const scale = _mm_set1_ps(fractionScale);
+
+        for(int i = 0; i < count; i += 4)
+        {
+            alignas(16) uint32_t index[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_srli_epi32(phases, fractionBits));
+
+            auto const below = _mm_setr_ps(t[index[0]],     t[index[1]],     t[index[2]],     t[index[3]]);
+            auto const above = _mm_setr_ps(t[index[0] + 1], t[index[1] + 1], t[index[2] + 1], t[index[3] + 1]);
+
+            _mm_store_ps(base.data() + i, below);
+            _mm_store_ps(slope.data() + i, _mm_sub_ps(above, below));
+            _mm_store_ps(fraction.data() + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phases, mask)), scale));
+
+            phases = _mm_add_epi32(phases, step);
+        }
+       #else
+        for(int i = 0; i < count; i++)
+        {
+            auto const index = p >> fractionBits;
+            auto const k     = static_cast<size_t>(i);
+
+            base[k]     = t[index];
+            slope[k]    = t[index + 1] - t[index];
+            fraction[k] = static_cast<float>(p & fractionMask) * fractionScale;
+            p += inc;
+        }
+       #endif
+    }
+
+
+    /** 0, 1, 2, ... across the lanes of a vector. */
+    static Vec laneOffsets()
+    {
+        alignas(sizeof(Vec)) float offsets[lanes];
+        for(int i = 0; i < lanes; i++){offsets[i] = static_cast<float>(i);}
+        return Vec::fromRawArray(offsets);
+    }
+
+
+    void removeVoice(int v)
+    {
+        int const last = --numVoices;
+
+        note[v]       = note[last];
+        level[v]      = level[last];
+        rampLeft[v]   = rampLeft[last];
+        held[v]       = held[last];
+        phase[v]      = phase[last];
+        increment[v]  = increment[last];
+        age[v]        = age[last];
+        gain[v]       = gain[last];
+        gainStep[v]   = gainStep[last];
+        gainTarget[v] = gainTarget[last];
+        table[v]      = table[last];
+    }
+
+};
@@ -0,0 +1,109 @@
+#include "BatchRender.h"
+#include "OfflineRender.h"
+#include <iostream>
+
+namespace
+{
+    /** Takes the next job until none are left, reusing its engine from file to file. */
+    class Worker : public juce::Thread,
+                   public SIMDAligned
+    {
+    public:
+
+        Worker(juce::Array<BatchRender::Job> const& j, int block, std::atomic<int>& next, std::atomic<int>& failed,
+               juce::CriticalSection& lock)
+            : juce::Thread("Batch Render"), jobs(j), blockSize(block), nextJob(next), numFailed(failed), printLock(lock) {}
+
+        void run() override
+        {
+            for (int index = nextJob++; index < jobs.size() && ! threadShouldExit(); index = nextJob++)
+            {
+                auto const& job  = jobs.getReference(index);
+                auto const start = juce::Time::getMillisecondCounterHiRes();
+                auto const result = OfflineRender::render(engine, job.modulator, job.carrier, job.output,
+                                                          job.parameterSet, blockSize, job.midi);
+
+                if (result.failed()){numFailed++;}
+
+                const juce::ScopedLock lock(printLock);
+
+                if (result.failed()) std::cerr << "failed " << result.getErrorMessage() << std::endl;
+                else                 std::cout << "ok " << job.output.getFullPathName() << " ("
+                                               << (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0 << " s)" << std::endl;
+            }
+        }
+
+    private:
+
+        VocoderEngine engine;
+
+        juce::Array<BatchRender::Job> const& jobs;
+        int const blockSize;
+        std::atomic<int>& nextJob;
+        std::atomic<int>& numFailed;
+        juce::CriticalSection& printLock;
+    };
+}
+
+
+juce::Result BatchRender::loadManifest(juce::File const& manifest, ParameterSet const& defaults, juce::Array<Job>& jobs)
+{
+    auto const json = juce::JSON::parse(manifest);
+
+    if (! json.isArray()){return juce::Result::fail("Expected a JSON array in " + manifest.getFullPathName());}
+
+    auto const folder  = manifest.getParentDirectory();
+    auto const getFile = [&folder] (juce::var const& entry, char const* key)
+    {
+        auto const path = entry.getProperty(key, {}).toString();
+        return path.isEmpty() ? juce::File() : folder.getChildFile(path);
+    };
+
+    for (auto const& entry : *json.getArray())
+    {
+        Job job;
+        job.modulator    = getFile(entry, "modulator");
+        job.carrier      = getFile(entry, "carrier");
+        job.midi         = getFile(entry, "midi");
+        job.output       = getFile(entry, "output");
+        job.parameterSet = defaults;
+
+        if (job.modulator == juce::File() || job.output == juce::File())
+            return juce::Result::fail("Every entry in " + manifest.getFullPathName() + " needs a modulator and an output");
+
+        if (auto* params = entry.getProperty("params", {}).getDynamicObject())
+        {
+            for (auto const& property : params->getProperties())
+            {
+                if (! job.parameterSet.set(property.name.toString(), static_cast<float>(property.value)))
+                    return juce::Result::fail("Unknown parameter " + property.name.toString() + " in " + manifest.getFullPathName());
+            }
+        }
+
+        //The files already keep every core busy; band partitions would only add hand-offs
+        job.parameterSet.parameters.multiCore = false;
+
+        jobs.add(job);
+    }
+
+    return juce::Result::ok();
+}
+
+
+int BatchRender::run(juce::Array<Job> const& jobs, int blockSize, int numThreads)
+{
+    std::atomic<int> nextJob{0}, numFailed{0};
+    juce::CriticalSection printLock;
+
+    juce::OwnedArray<Worker> workers;
+
+    for (int i = 0; i < juce::jmin(numThreads, jobs.size()); i++)
+    {
+        workers.add(new Worker(jobs, blockSize, nextJob, numFailed, printLock));
+        workers.getLast()->startThread();
+    }
+
+    for (auto* worker : workers){worker->waitForThreadToExit(-1);}
+
+    return numFailed.load();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSet.h"
+
+//==============================================================================
+/**
+    Renders a manifest of files concurrently, one worker thread and one engine per
+    core. Every file streams through OfflineRender::render(), so memory use is a few
+    blocks per worker however long the files are.
+
+    The manifest is a JSON array of objects such as
+        {"modulator": "voice.wav", "carrier": "pad.wav", "output": "out/voice.wav", "params": {"num_bands": 32}}
+    where "carrier", "midi" and "params" are optional. Relative paths are taken from
+    the manifest's folder; "params" override the parameters given on the command line.
+*/
+struct BatchRender
+{
+    struct Job
+    {
+        juce::File modulator, carrier, midi, output;
+        ParameterSet parameterSet;
+    };
+
+    static juce::Result loadManifest(juce::File const& manifest, ParameterSet const& defaults, juce::Array<Job>& jobs);
+
+    /** Runs every job and prints one line per file; returns the number of failed jobs. */
+    static int run(juce::Array<Job> const& jobs, int blockSize, int numThreads);
+};
@@ -0,0 +1,274 @@
+#include "Benchmark.h"
+#include <iostream>
+
+namespace
+{
+    template <typename Type>
+    juce::Array<Type> parseList(juce::ArgumentList const& args, juce::StringRef option, juce::Array<Type> fallback)
+    {
+        if (! args.containsOption(option)){return fallback;}
+
+        juce::Array<Type> values;
+
+        for (auto const& token : juce::StringArray::fromTokens(args.getValueForOption(option), ",", {}))
+            values.add(static_cast<Type>(token.getDoubleValue()));
+
+        return values;
+    }
+
+    double secondsSince(juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    //Noise modulator, generated once so only the engine and the block copy are timed
+    juce::AudioBuffer<float> makeNoise(int numChannels, int numSamples)
+    {
+        juce::AudioBuffer<float> source (numChannels, numSamples);
+        juce::Random random (1234);
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            auto* data = source.getWritePointer(channel);
+            for (int i = 0; i < numSamples; i++){data[i] = random.nextFloat() * 2.f - 1.f;}
+        }
+
+        return source;
+    }
+
+    //Notes a semitone apart from C2 upwards, all starting on the first sample
+    juce::MidiBuffer makeChord(int numVoices)
+    {
+        juce::MidiBuffer chord;
+
+        for (int voice = 0; voice < numVoices; voice++)
+            chord.addEvent(juce::MidiMessage::noteOn(1, 36 + voice, 0.8f), 0);
+
+        return chord;
+    }
+
+    /** Feeds the source through the engine the way a host would, block by block; the
+        chord arrives with the first block and is held to the end. */
+    void renderBlocks(VocoderEngine& engine, juce::AudioBuffer<float> const& source, juce::AudioBuffer<float>& block,
+                      juce::MidiBuffer const& chord, VocoderParameters const& parameters)
+    {
+        juce::MidiBuffer const noMidi;
+
+        auto const numChannels  = source.getNumChannels();
+        auto const totalSamples = source.getNumSamples();
+        auto const blockSize    = block.getNumSamples();
+
+        for (int position = 0; position < totalSamples; position += blockSize)
+        {
+            auto const numSamples = juce::jmin(blockSize, totalSamples - position);
+            block.setSize(numChannels, numSamples, false, false, true);
+
+            for (int channel = 0; channel < numChannels; channel++)
+                block.copyFrom(channel, 0, source, channel, position, numSamples);
+
+            RealtimeCheck::ScopedRealtime realtime;
+            engine.process(block, position == 0 ? chord : noMidi, parameters);
+        }
+
+        block.setSize(numChannels, blockSize, false, false, true);
+    }
+}
+
+
+Benchmark::Options Benchmark::parseOptions(juce::ArgumentList const& args)
+{
+    Options options;
+
+    options.sampleRates = parseList(args, "--rates", options.sampleRates);
+    options.bandCounts  = parseList(args, "--bands", options.bandCounts);
+    options.blockSizes  = parseList(args, "--blocks", options.blockSizes);
+    options.waveforms   = parseList(args, "--waves", options.waveforms);
+
+    if (args.containsOption("--channels")){options.numChannels = juce::jlimit(1, FilterBank::maxChannels, args.getValueForOption("--channels").getIntValue());}
+    if (args.containsOption("--voices"))  {options.numVoices = juce::jlimit(0, VoicePool::maxVoices, args.getValueForOption("--voices").getIntValue());}
+    if (args.containsOption("--streams")) {options.numStreams = juce::jmax(0, args.getValueForOption("--streams").getIntValue());}
+    if (args.containsOption("--seconds")) {options.seconds = juce::jmax(0.01, args.getValueForOption("--seconds").getDoubleValue());}
+    if (args.containsOption("--repeats")) {options.repeats = juce::jmax(1, args.getValueForOption("--repeats").getIntValue());}
+
+    options.json = args.getValueForOption("--format") == "json";
+
+    return options;
+}
+
+
+Benchmark::Result Benchmark::measure(ParameterSet parameterSet, Options const& options,
+                                     double sampleRate, int numBands, int blockSize, int waveform)
+{
+    parameterSet.layout.numBands     = numBands;
+    parameterSet.parameters.oscWave  = waveform;
+    if (options.numVoices > 0){parameterSet.parameters.carrier = VocoderEngine::midiCarrier;}
+
+    if (options.numStreams > 0){return measureBatch(parameterSet, options, sampleRate, blockSize);}
+
+    auto const totalSamples = static_cast<int>(options.seconds * sampleRate);
+    auto const source       = makeNoise(options.numChannels, totalSamples);
+    auto const chord        = makeChord(options.numVoices);
+
+    juce::AudioBuffer<float> block (options.numChannels, blockSize);
+    VocoderEngine engine;
+    if (parameterSet.parameters.multiCore){engine.createWorkerPool();}
+    double best = std::numeric_limits<double>::max();
+
+    for (int repeat = 0; repeat < options.repeats; repeat++)
+    {
+        engine.prepare(sampleRate, blockSize, options.numChannels, parameterSet.layout, parameterSet.oversampling);
+
+        auto const start = juce::Time::getHighResolutionTicks();
+        renderBlocks(engine, source, block, chord, parameterSet.parameters);
+        best = juce::jmin(best, secondsSince(start));
+    }
+
+    Result result;
+    result.sampleRate           = sampleRate;
+    result.numBands             = numBands;
+    result.activeBands          = engine.getNumActiveBands();
+    result.blockSize            = blockSize;
+    result.waveform             = waveform;
+    result.nanosecondsPerSample = best * 1.0e9 / totalSamples;
+    result.realtimeFactor       = (totalSamples / sampleRate) / best;
+    return result;
+}
+
+
+Benchmark::Result Benchmark::measureBatch(ParameterSet const& parameterSet, Options const& options, double sampleRate, int blockSize)
+{
+    auto const numStreams   = options.numStreams;
+    auto const totalSamples = static_cast<int>(options.seconds * sampleRate);
+    auto const source       = makeNoise(numStreams, totalSamples);
+
+    juce::AudioBuffer<float> block (numStreams, blockSize);
+    BatchVocoder batch;
+    double best = std::numeric_limits<double>::max();
+
+    for (int repeat = 0; repeat < options.repeats; repeat++)
+    {
+        batch.prepare(sampleRate, numStreams, parameterSet.layout);
+
+        auto const start = juce::Time::getHighResolutionTicks();
+
+        for (int position = 0; position < totalSamples; position += blockSize)
+        {
+            auto const numSamples = juce::jmin(blockSize, totalSamples - position);
+
+            for (int stream = 0; stream < numStreams; stream++)
+                block.copyFrom(stream, 0, source, stream, position, numSamples);
+
+            RealtimeCheck::ScopedRealtime realtime;
+            batch.process(block.getArrayOfReadPointers(), block.getArrayOfWritePointers(), numStreams, numSamples, parameterSet.parameters);
+        }
+
+        best = juce::jmin(best, secondsSince(start));
+    }
+
+    Result result;
+    result.sampleRate           = sampleRate;
+    result.numBands             = parameterSet.layout.numBands;
+    result.activeBands          = batch.getNumActiveBands();
+    result.blockSize            = blockSize;
+    result.waveform             = parameterSet.parameters.oscWave;
+    result.nanosecondsPerSample = best * 1.0e9 / (static_cast<double>(totalSamples) * numStreams);
+    result.realtimeFactor       = (totalSamples / sampleRate) * numStreams / best;
+    return result;
+}
+
+
+void Benchmark::run(ParameterSet const& parameterSet, Options const& options)
+{
+    if (! options.json)
+        std::cout << "sample_rate,num_bands,active_bands,block_size,waveform,ns_per_sample,realtime_factor" << std::endl;
+
+    for (auto sampleRate : options.sampleRates)
+    {
+        for (auto numBands : options.bandCounts)
+        {
+            for (auto blockSize : options.blockSizes)
+            {
+                for (auto waveform : options.waveforms)
+                {
+                    auto const r = measure(parameterSet, options, sampleRate, numBands, blockSize, waveform);
+
+                    if (options.json)
+                    {
+                        auto* row = new juce::DynamicObject();
+                        row->setProperty("sample_rate", r.sampleRate);
+                        row->setProperty("num_bands", r.numBands);
+                        row->setProperty("active_bands", r.activeBands);
+                        row->setProperty("block_size", r.blockSize);
+                        row->setProperty("waveform", r.waveform);
+                        row->setProperty("ns_per_sample", r.nanosecondsPerSample);
+                        row->setProperty("realtime_factor", r.realtimeFactor);
+
+                        //One JSON object per line, so partial runs are still parseable
+                        std::cout << juce::JSON::toString(juce::var(row), true) << std::endl;
+                    }
+                    else
+                    {
+                        std::cout << r.sampleRate << ',' << r.numBands << ',' << r.activeBands << ','
+                                  << r.blockSize << ',' << r.waveform << ','
+                                  << r.nanosecondsPerSample << ',' << r.realtimeFactor << std::endl;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+int Benchmark::profile(ParameterSet const& parameterSet, Options const& options)
+{
+    auto const violationsBefore = RealtimeCheck::getNumViolations();
+
+    std::cout << "sample_rate,num_bands,block_size,waveform,stage,count,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns" << std::endl;
+
+    for (auto sampleRate : options.sampleRates)
+    {
+        for (auto numBands : options.bandCounts)
+        {
+            for (auto blockSize : options.blockSizes)
+            {
+                for (auto waveform : options.waveforms)
+                {
+                    auto settings = parameterSet;
+                    settings.layout.numBands    = numBands;
+                    settings.parameters.oscWave = waveform;
+                    if (options.numVoices > 0){settings.parameters.carrier = VocoderEngine::midiCarrier;}
+
+                    auto const source = makeNoise(options.numChannels, static_cast<int>(options.seconds * sampleRate));
+                    auto const chord  = makeChord(options.numVoices);
+                    juce::AudioBuffer<float> block (options.numChannels, blockSize);
+
+                    VocoderEngine engine;
+                    if (settings.parameters.multiCore){engine.createWorkerPool();}
+                    engine.prepare(sampleRate, blockSize, options.numChannels, settings.layout, settings.oversampling);
+
+                    auto& profiler = engine.getProfiler();
+                    profiler.setEnabled(true);
+
+                    for (int repeat = 0; repeat < options.repeats; repeat++)
+                        renderBlocks(engine, source, block, chord, settings.parameters);
+
+                    for (int stage = 0; stage < AudioThreadProfiler::numStages; stage++)
+                    {
+                        auto const s = profiler.getSummary(stage);
+
+                        std::cout << sampleRate << ',' << numBands << ',' << blockSize << ',' << waveform << ','
+                                  << AudioThreadProfiler::getStageName(stage) << ',' << s.count << ',' << s.meanNs << ','
+                                  << s.p50Ns << ',' << s.p90Ns << ',' << s.p99Ns << ',' << s.p999Ns << ',' << s.maxNs << std::endl;
+                    }
+                }
+            }
+        }
+    }
+
+    auto const violations = RealtimeCheck::getNumViolations() - violationsBefore;
+
+    if (violations > 0)
+        std::cerr << violations << " realtime violations, the last one in " << RealtimeCheck::getLastViolation() << std::endl;
+
+    return violations;
+}
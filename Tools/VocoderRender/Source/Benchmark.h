@@ -0,0 +1,54 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSet.h"
+#include "../../../Source/BatchVocoder.h"
+
+//==============================================================================
+/**
+    Times VocoderEngine::process over a grid of sample rates, band counts, block sizes
+    and waveforms, and prints one machine-readable row per combination.
+*/
+struct Benchmark
+{
+    struct Options
+    {
+        juce::Array<double> sampleRates {44100.0, 48000.0, 96000.0, 192000.0};
+        juce::Array<int>    bandCounts  {1, 8, 16, 32, 48};
+        juce::Array<int>    blockSizes  {16, 64, 256, 1024, 4096};
+        juce::Array<int>    waveforms   {0, 1, 2, 3};
+        int    numChannels{2};
+        int    numVoices{0};
+        int    numStreams{0};
+        double seconds{1.0};
+        int    repeats{3};
+        bool   json{false};
+    };
+
+    struct Result
+    {
+        double sampleRate;
+        int    numBands, activeBands, blockSize, waveform;
+        double nanosecondsPerSample, realtimeFactor;
+    };
+
+    /** Options come from --rates=, --bands=, --blocks=, --waves= (comma separated),
+        --channels=, --voices=, --seconds=, --repeats= and --format=csv|json. With
+        --voices=N the carrier is the MIDI voice pool holding an N-note chord. With --streams=N
+        BatchVocoder runs N mono streams instead of the engine, and the timings are per stream. */
+    static Options parseOptions(juce::ArgumentList const& args);
+
+    static Result measure(ParameterSet parameterSet, Options const& options,
+                          double sampleRate, int numBands, int blockSize, int waveform);
+
+    /** As measure(), for the batch vocoder once the settings are applied. */
+    static Result measureBatch(ParameterSet const& parameterSet, Options const& options, double sampleRate, int blockSize);
+
+    /** Runs the whole grid and writes the rows to stdout. */
+    static void run(ParameterSet const& parameterSet, Options const& options);
+
+    /** Runs the grid with the engine's stage profiler on and prints per-stage percentiles
+        as CSV. Every block runs inside a RealtimeCheck::ScopedRealtime; returns the number
+        of realtime violations; heap use only counts with VOCODER_TRAP_REALTIME_VIOLATIONS. */
+    static int profile(ParameterSet const& parameterSet, Options const& options);
+};
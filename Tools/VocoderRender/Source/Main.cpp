@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    Headless front end for the vocoder engine: offline rendering of WAV files,
+    singly or as a parallel batch, a throughput benchmark, a realtime-safety
+    profiler for the DSP core and an accuracy check of its optimised paths.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ParameterSet.h"
+#include "OfflineRender.h"
+#include "BatchRender.h"
+#include "Benchmark.h"
+#include "Verify.h"
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand ("--help|-h", "Usage:", true);
+
+    app.addCommand ({ "render",
+                      "render --input=<in.wav> --output=<out.wav> [--carrier=<carrier.wav>] [--block=512] [--midi=<notes.mid>]"
+                      " [--params=<file.json>] [name=value ...]",
+                      "Vocodes a WAV file offline.",
+                      "The input is used as the modulator (or as the carrier with switch_car_mod=1).\n"
+                      "Parameters use the plugin's IDs, e.g. num_bands=24 q=8 osc_wave=2.\n"
+                      "--carrier replaces the internal carrier with a file of the same sample rate.\n"
+                      "With carrier=1 the notes of --midi play the voice pool instead of the oscillator.",
+                      [] (juce::ArgumentList const& args)
+                      {
+                          ParameterSet parameterSet;
+                          auto const parsed = parameterSet.applyArguments (args);
+                          if (parsed.failed()) juce::ConsoleApplication::fail (parsed.getErrorMessage());
+
+                          auto const blockSize = args.containsOption ("--block") ? args.getValueForOption ("--block").getIntValue() : 512;
+
+                          auto const result = OfflineRender::run (args.getExistingFileForOption ("--input"),
+                                                                  args.containsOption ("--carrier") ? args.getExistingFileForOption ("--carrier") : juce::File(),
+                                                                  args.getFileForOption ("--output"),
+                                                                  parameterSet, juce::jmax (1, blockSize),
+                                                                  args.containsOption ("--midi") ? args.getExistingFileForOption ("--midi") : juce::File());
+                          if (result.failed()) juce::ConsoleApplication::fail (result.getErrorMessage());
+                      }});
+
+    app.addCommand ({ "batch",
+                      "batch --manifest=<jobs.json> [--block=512] [--threads=<cores>] [--params=<file.json>] [name=value ...]",
+                      "Vocodes every file pair of a manifest, one file per core at a time.",
+                      "The manifest is a JSON array of {\"modulator\", \"carrier\", \"midi\", \"output\", \"params\"} objects;\n"
+                      "carrier, midi and params are optional and params override the command line.\n"
+                      "Files are streamed block by block, so memory use does not depend on their length.",
+                      [] (juce::ArgumentList const& args)
+                      {
+                          ParameterSet parameterSet;
+                          auto const parsed = parameterSet.applyArguments (args);
+                          if (parsed.failed()) juce::ConsoleApplication::fail (parsed.getErrorMessage());
+
+                          juce::Array<BatchRender::Job> jobs;
+                          auto const loaded = BatchRender::loadManifest (args.getExistingFileForOption ("--manifest"), parameterSet, jobs);
+                          if (loaded.failed()) juce::ConsoleApplication::fail (loaded.getErrorMessage());
+
+                          auto const blockSize  = args.containsOption ("--block") ? args.getValueForOption ("--block").getIntValue() : 512;
+                          auto const numThreads = args.containsOption ("--threads") ? args.getValueForOption ("--threads").getIntValue()
+                                                                                    : juce::SystemStats::getNumCpus();
+
+                          auto const numFailed = BatchRender::run (jobs, juce::jmax (1, blockSize), juce::jmax (1, numThreads));
+                          if (numFailed > 0) juce::ConsoleApplication::fail (juce::String (numFailed) + " of " + juce::String (jobs.size()) + " files failed");
+                      }});
+
+    app.addCommand ({ "bench",
+                      "bench [--rates=44100,...] [--bands=1,...] [--blocks=16,...] [--waves=0,1,2,3] [--channels=2] [--voices=0] [--streams=0]"
+                      " [--seconds=1] [--repeats=3] [--format=csv|json] [--params=<file.json>] [name=value ...]",
+                      "Measures ns/sample and realtime factor of the DSP core.",
+                      "Prints CSV (default) or one JSON object per line for every combination.\n"
+                      "Unless overridden, the band layout uses low_freq=50 and wide=1.1 so all 48 bands fit below 20 kHz.\n"
+                      "--streams=N times the batch vocoder on N mono streams instead; rows are then per stream.",
+                      [] (juce::ArgumentList const& args)
+                      {
+                          ParameterSet parameterSet;
+                          parameterSet.layout.lowFreq = 50.f;
+                          parameterSet.layout.wide    = 1.1f;
+
+                          auto const parsed = parameterSet.applyArguments (args);
+                          if (parsed.failed()) juce::ConsoleApplication::fail (parsed.getErrorMessage());
+
+                          Benchmark::run (parameterSet, Benchmark::parseOptions (args));
+                      }});
+
+    app.addCommand ({ "profile",
+                      "profile [bench options] [name=value ...]",
+                      "Prints per-stage timing percentiles of the audio callback and checks it is realtime safe.",
+                      "Takes the same options as bench except --format and --streams and prints CSV rows per stage.\n"
+                      "Fails if any block allocated or reached a locking call on the audio thread.",
+                      [] (juce::ArgumentList const& args)
+                      {
+                          ParameterSet parameterSet;
+                          parameterSet.layout.lowFreq = 50.f;
+                          parameterSet.layout.wide    = 1.1f;
+
+                          auto const parsed = parameterSet.applyArguments (args);
+                          if (parsed.failed()) juce::ConsoleApplication::fail (parsed.getErrorMessage());
+
+                          if (Benchmark::profile (parameterSet, Benchmark::parseOptions (args)) > 0)
+                              juce::ConsoleApplication::fail ("Realtime violations on the audio thread");
+                      }});
+
+    app.addCommand ({ "verify",
+                      "verify [--rate=48000] [--block=256] [--seconds=2] [--repeats=3] [--baseline=<results.json>] [--save=<results.json>]"
+                      " [--max-slowdown=0.1] [--params=<file.json>] [name=value ...]",
+                      "Compares every processing path with the plugin's original block-RMS vocoder, kept as a reference.",
+                      "Runs a sweep, noise and a speech-like signal through each path and prints CSV rows with the\n"
+                      "sample error, worst band error and log-spectral distance in dB, the speed in ns/sample and the\n"
+                      "speedup over the reference. Fails if a metric exceeds the path's tolerance or if the speedup\n"
+                      "dropped by more than --max-slowdown against the baseline without getting more accurate.\n"
+                      "Speed is only checked with --baseline, e.g. Tools/VocoderRender/baseline.json; --save writes the\n"
+                      "results as a new one.",
+                      [] (juce::ArgumentList const& args)
+                      {
+                          ParameterSet parameterSet;
+
+                          auto const parsed = parameterSet.applyArguments (args);
+                          if (parsed.failed()) juce::ConsoleApplication::fail (parsed.getErrorMessage());
+
+                          auto const numFailed = Verify::run (parameterSet, Verify::parseOptions (args));
+                          if (numFailed > 0) juce::ConsoleApplication::fail (juce::String (numFailed) + " checks failed");
+                      }});
+
+    return app.findAndRunCommand (argc, argv);
+}
@@ -0,0 +1,189 @@
+#include "OfflineRender.h"
+
+namespace
+{
+    /** Reads a file block by block. WAV files are memory mapped one window at a time,
+        anything else, or a file that cannot be mapped, is streamed. */
+    class ChunkedReader
+    {
+    public:
+
+        ChunkedReader(juce::AudioFormatManager& f, juce::File const& fileToRead)
+            : formats(f), file(fileToRead)
+        {
+            if (auto* format = formats.findFormatForFileExtension(file.getFileExtension()))
+                mapped.reset(format->createMemoryMappedReader(file));
+
+            if (mapped == nullptr){streamed.reset(formats.createReaderFor(file));}
+        }
+
+        juce::AudioFormatReader* get() const { return mapped != nullptr ? mapped.get() : streamed.get(); }
+
+
+        /** Fills the first numSamples of buffer; anything past the end of the file is silence. */
+        void read(juce::AudioBuffer<float>& buffer, juce::int64 startSample, int numSamples)
+        {
+            if (mapped != nullptr)
+            {
+                auto const length = mapped->lengthInSamples;
+                juce::Range<juce::int64> const wanted (juce::jmin(startSample, length), juce::jmin(startSample + numSamples, length));
+
+                if (! wanted.isEmpty() && ! mapped->getMappedSection().contains(wanted))
+                {
+                    if (! mapped->mapSectionOfFile({wanted.getStart(), juce::jmin(wanted.getStart() + windowSamples, length)}))
+                    {
+                        mapped.reset();
+                        streamed.reset(formats.createReaderFor(file));
+                    }
+                }
+            }
+
+            if (auto* reader = get()){reader->read(&buffer, 0, numSamples, startSample, true, true);}
+            else                     buffer.clear(0, numSamples);
+        }
+
+    private:
+
+        //6 MB of address space for 24-bit stereo; the pages are file backed and reclaimable
+        juce::int64 constexpr static windowSamples = 1 << 20;
+
+        juce::AudioFormatManager& formats;
+        juce::File const file;
+
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped;
+        std::unique_ptr<juce::AudioFormatReader> streamed;
+    };
+
+
+    //All tracks merged into one sequence with timestamps in seconds
+    juce::Result loadMidi(juce::File const& file, juce::MidiMessageSequence& notes)
+    {
+        juce::FileInputStream stream (file);
+        juce::MidiFile midiFile;
+
+        if (! stream.openedOk() || ! midiFile.readFrom(stream))
+            return juce::Result::fail("Cannot read " + file.getFullPathName());
+
+        midiFile.convertTimestampTicksToSeconds();
+
+        for (int track = 0; track < midiFile.getNumTracks(); track++)
+            notes.addSequence(*midiFile.getTrack(track), 0.0);
+
+        notes.updateMatchedPairs();
+        return juce::Result::ok();
+    }
+}
+
+
+juce::Result OfflineRender::run(juce::File const& input, juce::File const& carrier, juce::File const& output,
+                                ParameterSet const& parameterSet, int blockSize,
+                                juce::File const& midiInput)
+{
+    VocoderEngine engine;
+    if (parameterSet.parameters.multiCore){engine.createWorkerPool();}
+
+    return render(engine, input, carrier, output, parameterSet, blockSize, midiInput);
+}
+
+
+juce::Result OfflineRender::render(VocoderEngine& engine, juce::File const& modulator, juce::File const& carrier,
+                                   juce::File const& output, ParameterSet const& parameterSet, int blockSize,
+                                   juce::File const& midiInput)
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    ChunkedReader reader (formats, modulator);
+    if (reader.get() == nullptr){return juce::Result::fail("Cannot read " + modulator.getFullPathName());}
+
+    std::unique_ptr<ChunkedReader> carrierReader;
+
+    if (carrier != juce::File())
+    {
+        carrierReader = std::make_unique<ChunkedReader>(formats, carrier);
+
+        if (carrierReader->get() == nullptr)
+            return juce::Result::fail("Cannot read " + carrier.getFullPathName());
+
+        if (carrierReader->get()->sampleRate != reader.get()->sampleRate)
+            return juce::Result::fail(carrier.getFullPathName() + " does not have the sample rate of " + modulator.getFullPathName());
+    }
+
+    juce::MidiMessageSequence notes;
+
+    if (midiInput != juce::File())
+    {
+        auto const loaded = loadMidi(midiInput, notes);
+        if (loaded.failed()){return loaded;}
+    }
+
+    auto const numChannels = juce::jmin(static_cast<int>(reader.get()->numChannels), FilterBank::maxChannels);
+    auto const sampleRate  = reader.get()->sampleRate;
+
+    output.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream (output.createOutputStream());
+    if (stream == nullptr){return juce::Result::fail("Cannot write " + output.getFullPathName());}
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor(stream.get(), sampleRate,
+                                                                         static_cast<unsigned int>(numChannels),
+                                                                         24, {}, 0));
+    if (writer == nullptr){return juce::Result::fail("Cannot create a WAV writer for " + output.getFullPathName());}
+    stream.release();
+
+    auto const numCarrierChannels = carrierReader != nullptr ? juce::jmin(static_cast<int>(carrierReader->get()->numChannels), FilterBank::maxChannels) : 0;
+
+    engine.prepare(sampleRate, blockSize, juce::jmax(numChannels, numCarrierChannels), parameterSet.layout, parameterSet.oversampling);
+
+    //Batch jobs on the same modulator can then reuse each other's analysis when they run in step
+    if (parameterSet.parameters.sharedAnalysis){engine.enableSharedAnalysis();}
+
+    auto parameters = parameterSet.parameters;
+    parameters.nonRealtime = true;
+
+    //The spectral mode delays its output, so the render runs on past the end and drops the head
+    auto const latency = static_cast<juce::int64>(engine.getLatencySamples(parameters.mode));
+    auto const length  = reader.get()->lengthInSamples + latency;
+
+    juce::AudioBuffer<float> buffer (numChannels, blockSize);
+    juce::AudioBuffer<float> carrierBuffer (juce::jmax(1, numCarrierChannels), blockSize);
+    juce::MidiBuffer midi;
+    int nextNote = 0;
+
+    for (juce::int64 position = 0; position < length; position += blockSize)
+    {
+        auto const numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(blockSize), length - position));
+
+        buffer.setSize(numChannels, numSamples, false, false, true);
+        reader.read(buffer, position, numSamples);
+
+        if (carrierReader != nullptr)
+        {
+            carrierReader->read(carrierBuffer, position, numSamples);
+            engine.process(buffer, carrierBuffer.getArrayOfReadPointers(), numCarrierChannels, parameters);
+        }
+        else
+        {
+            midi.clear();
+
+            for (; nextNote < notes.getNumEvents(); nextNote++)
+            {
+                auto const& message = notes.getEventPointer(nextNote)->message;
+                auto const sample   = juce::roundToInt(message.getTimeStamp() * sampleRate) - position;
+
+                if (sample >= numSamples){break;}
+                midi.addEvent(message, static_cast<int>(juce::jmax(static_cast<juce::int64>(0), sample)));
+            }
+
+            engine.process(buffer, midi, parameters);
+        }
+
+        auto const skip = static_cast<int>(juce::jlimit(static_cast<juce::int64>(0), static_cast<juce::int64>(numSamples), latency - position));
+        if (skip == numSamples){continue;}
+
+        if (! writer->writeFromAudioSampleBuffer(buffer, skip, numSamples - skip))
+            return juce::Result::fail("Write failed for " + output.getFullPathName());
+    }
+
+    return juce::Result::ok();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSet.h"
+
+//==============================================================================
+/**
+    Streams a WAV file through the engine in fixed-size blocks and writes the result
+    next to it, with the same sample rate and channel count (up to FilterBank::maxChannels).
+    The engine latency is compensated, so input and output line up sample for sample.
+    A MIDI file, if given, plays the voice pool when the MIDI carrier is selected.
+
+    Inputs are read one block at a time: WAV files through a memory-mapped window that
+    slides along the file, other formats through a streaming reader, so memory use does
+    not grow with the length of the file.
+*/
+struct OfflineRender
+{
+    /** If carrier is not the default File, it replaces the internal carrier; it must have
+        the input's sample rate and reads as silence past its end. */
+    static juce::Result run(juce::File const& input, juce::File const& carrier, juce::File const& output,
+                            ParameterSet const& parameterSet, int blockSize,
+                            juce::File const& midiInput = {});
+
+    /** As run(), but with an existing engine, which is prepared for the file here. */
+    static juce::Result render(VocoderEngine& engine, juce::File const& modulator, juce::File const& carrier,
+                               juce::File const& output, ParameterSet const& parameterSet, int blockSize,
+                               juce::File const& midiInput = {});
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../../Source/VocoderEngine.h"
+
+//==============================================================================
+/**
+    Engine settings addressed by the plugin's parameter IDs, so parameter sets can be
+    copied between the plugin and the command line. Defaults match the plugin.
+*/
+struct ParameterSet
+{
+    BandLayout layout;
+    VocoderParameters parameters;
+
+    //Set at prepare time rather than per block, as in the plugin
+    int oversampling{VocoderEngine::oversamplingOff};
+
+
+    /** Returns false if the name is not a known parameter ID. */
+    bool set(juce::String const& name, float value)
+    {
+        if      (name == "osc_freq")       parameters.oscFreq       = value;
+        else if (name == "osc_wave")       parameters.oscWave       = juce::roundToInt(value);
+        else if (name == "carrier")        parameters.carrier       = juce::roundToInt(value);
+        else if (name == "mode")           parameters.mode          = juce::roundToInt(value);
+        else if (name == "oversampling")   oversampling             = juce::roundToInt(value);
+        else if (name == "num_bands")      layout.numBands          = juce::roundToInt(value);
+        else if (name == "spectral_bands") layout.spectralBands     = juce::roundToInt(value);
+        else if (name == "low_freq")       layout.lowFreq           = value;
+        else if (name == "high_freq")      layout.highFreq          = value;
+        else if (name == "q")              layout.q                 = value;
+        else if (name == "band_order")     layout.numSections       = juce::roundToInt(value) + 1;
+        else if (name == "rms_gain")       parameters.rmsGain       = value;
+        else if (name == "attack")         parameters.attack        = value;
+        else if (name == "release")        parameters.release       = value;
+        else if (name == "detector")       parameters.detector      = juce::roundToInt(value);
+        else if (name == "wide")           layout.wide              = value;
+        else if (name == "switch_car_mod") parameters.switchCarrMod = value > 0.5f;
+        else if (name == "linked")         parameters.linkedAnalysis = value > 0.5f;
+        else if (name == "bypass_mod")     parameters.bypassMod     = value > 0.5f;
+        else if (name == "out_gain")       parameters.outGain       = value;
+        else if (name == "multi_core")     parameters.multiCore     = value > 0.5f;
+        else if (name == "share_analysis") parameters.sharedAnalysis = value > 0.5f;
+        else return false;
+
+        return true;
+    }
+
+
+    /** Reads a JSON object such as {"num_bands": 32, "q": 8}. */
+    juce::Result loadFromJSON(juce::File const& file)
+    {
+        auto const json = juce::JSON::parse(file);
+
+        if (auto* object = json.getDynamicObject())
+        {
+            for (auto const& property : object->getProperties())
+            {
+                if (! set(property.name.toString(), static_cast<float>(property.value)))
+                    return juce::Result::fail("Unknown parameter " + property.name.toString() + " in " + file.getFullPathName());
+            }
+
+            return juce::Result::ok();
+        }
+
+        return juce::Result::fail("Expected a JSON object in " + file.getFullPathName());
+    }
+
+
+    /** Applies --params=<file.json> followed by every name=value argument, in order. */
+    juce::Result applyArguments(juce::ArgumentList const& args)
+    {
+        if (args.containsOption("--params"))
+        {
+            auto const result = loadFromJSON(args.getExistingFileForOption("--params"));
+            if (result.failed()){return result;}
+        }
+
+        for (int i = 0; i < args.size(); i++)
+        {
+            auto const& text = args[i].text;
+
+            if (text.startsWith("-") || ! text.containsChar('=')){continue;}
+
+            auto const name = text.upToFirstOccurrenceOf("=", false, false);
+
+            if (! set(name, text.fromFirstOccurrenceOf("=", false, false).getFloatValue()))
+                return juce::Result::fail("Unknown parameter " + name);
+        }
+
+        return juce::Result::ok();
+    }
+};
@@ -0,0 +1,123 @@
+#include "ReferenceVocoder.h"
+
+ReferenceVocoder::ReferenceVocoder(double sampleRate, BandLayout const& layout, VocoderParameters const& parameters)
+{
+    //Band centres grow geometrically from lowFreq; the original only designed the ones below highFreq
+    float const freqStep   = layout.highFreq / static_cast<float>(layout.numBands);
+    float const freqFactor = layout.highFreq / (layout.highFreq - freqStep) * layout.wide;
+    float const maxFreq    = juce::jmin(layout.highFreq, 0.49f * static_cast<float>(sampleRate));
+    float frequency        = layout.lowFreq;
+
+    for (int i = 0; i < layout.numBands && frequency < maxFreq; i++)
+    {
+        bands.push_back(Coefficients::makeBandPass(sampleRate, frequency, layout.q));
+        frequency *= freqFactor;
+    }
+
+    rmsGain = parameters.rmsGain;
+    outGain = parameters.outGain;
+}
+
+
+void ReferenceVocoder::process(juce::AudioBuffer<float> const& modulator, juce::AudioBuffer<float> const& carrier,
+                               juce::AudioBuffer<float>& output, int blockSize) const
+{
+    int const numModChannels = modulator.getNumChannels();
+    int const numCarChannels = carrier.getNumChannels();
+    int const numSamples     = juce::jmin(modulator.getNumSamples(), carrier.getNumSamples());
+
+    output.setSize(numCarChannels, numSamples);
+    output.clear();
+
+    auto modulatorFilters = makeFilters(numModChannels);
+    auto carrierFilters   = makeFilters(numCarChannels);
+
+    juce::AudioBuffer<float> modBuffer (numModChannels, blockSize);
+    juce::AudioBuffer<float> carBuffer (numCarChannels, blockSize);
+    std::vector<float> rmsValues (bands.size());
+
+    for (int position = 0; position < numSamples; position += blockSize)
+    {
+        auto const n = juce::jmin(blockSize, numSamples - position);
+        modBuffer.setSize(numModChannels, n, false, false, true);
+        carBuffer.setSize(numCarChannels, n, false, false, true);
+
+        //Calculate RMS Value for every band of the incoming signal
+        for (size_t i = 0; i < bands.size(); i++)
+        {
+            filterBlock(modulatorFilters[i], modulator, position, modBuffer);
+
+            float sum = 0;
+            for (int channel = 0; channel < numModChannels; channel++)
+            {
+                sum += modBuffer.getRMSLevel(channel, 0, n) / numModChannels;
+            }
+
+            rmsValues[i] = sum * rmsGain;
+        }
+
+        //apply filter-bands on the carrier and apply rms-gains to each band accordingly
+        for (size_t i = 0; i < bands.size(); i++)
+        {
+            filterBlock(carrierFilters[i], carrier, position, carBuffer);
+            carBuffer.applyGain(rmsValues[i]);
+
+            for (int channel = 0; channel < numCarChannels; channel++)
+            {
+                output.addFrom(channel, position, carBuffer, channel, 0, n);
+            }
+        }
+    }
+
+    output.applyGain(outGain);
+}
+
+
+std::vector<std::vector<ReferenceVocoder::Filter>> ReferenceVocoder::makeFilters(int numChannels) const
+{
+    std::vector<std::vector<Filter>> filters (bands.size());
+
+    for (size_t i = 0; i < bands.size(); i++)
+    {
+        for (int channel = 0; channel < numChannels; channel++)
+            filters[i].emplace_back(bands[i]);
+    }
+
+    return filters;
+}
+
+
+void ReferenceVocoder::filterBlock(std::vector<Filter>& filters, juce::AudioBuffer<float> const& signal,
+                                   int position, juce::AudioBuffer<float>& block)
+{
+    for (int channel = 0; channel < block.getNumChannels(); channel++)
+    {
+        block.copyFrom(channel, 0, signal, channel, position, block.getNumSamples());
+
+        auto* data = block.getWritePointer(channel);
+        juce::dsp::AudioBlock<float> channelBlock (&data, 1, static_cast<size_t>(block.getNumSamples()));
+        filters[static_cast<size_t>(channel)].process(juce::dsp::ProcessContextReplacing<float>(channelBlock));
+    }
+}
+
+
+std::vector<double> ReferenceVocoder::getBandEnergies(juce::AudioBuffer<float> const& signal, int start, int length) const
+{
+    std::vector<double> energies (bands.size());
+
+    for (int channel = 0; channel < signal.getNumChannels(); channel++)
+    {
+        for (size_t band = 0; band < bands.size(); band++)
+        {
+            Filter filter (bands[band]);
+
+            for (int i = start; i < start + length; i++)
+            {
+                auto const y = static_cast<double>(filter.processSample(signal.getSample(channel, i)));
+                energies[band] += y * y;
+            }
+        }
+    }
+
+    return energies;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../../Source/VocoderEngine.h"
+
+//==============================================================================
+/**
+    The plugin's original processBlock, frozen: one juce::dsp::IIR band-pass per band
+    and channel in single precision, the level of every modulator band taken once per
+    block with getRMSLevel and every carrier band scaled by it with one applyGain per
+    block before it is summed into the output.
+
+    It is the baseline the engine's optimised paths are verified against, so it keeps
+    its own copy of the band placement and must not be changed along with the engine.
+    It only departs from the original where that could not run at all: bands at or
+    above Nyquist are left out instead of being designed unstable, and the modulator
+    and carrier arrive as separate buffers. Bands are always second order, as they
+    were then.
+*/
+class ReferenceVocoder
+{
+public:
+
+    ReferenceVocoder(double sampleRate, BandLayout const& layout, VocoderParameters const& parameters);
+
+    int getNumBands() const { return static_cast<int>(bands.size()); }
+
+    /** Vocodes whole signals in host blocks of blockSize, so the band levels are held for
+        as long as they were in the plugin; output gets one channel per carrier channel. */
+    void process(juce::AudioBuffer<float> const& modulator, juce::AudioBuffer<float> const& carrier,
+                 juce::AudioBuffer<float>& output, int blockSize) const;
+
+    /** Energy of [start, start + length) of the signal in each band, summed over its channels. */
+    std::vector<double> getBandEnergies(juce::AudioBuffer<float> const& signal, int start, int length) const;
+
+private:
+
+    using Filter       = juce::dsp::IIR::Filter<float>;
+    using Coefficients = juce::dsp::IIR::Coefficients<float>;
+
+    /** One filter per band, the way a ProcessorDuplicator kept one per channel. */
+    std::vector<std::vector<Filter>> makeFilters(int numChannels) const;
+
+    /** Copies [position, position + block.getNumSamples()) of the signal into block and runs
+        the band's filters over it in place. */
+    static void filterBlock(std::vector<Filter>& filters, juce::AudioBuffer<float> const& signal,
+                            int position, juce::AudioBuffer<float>& block);
+
+    std::vector<Coefficients::Ptr> bands;
+
+    float rmsGain{1.f}, outGain{1.f};
+};
@@ -0,0 +1,461 @@
+#include "Verify.h"
+#include "ReferenceVocoder.h"
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+    struct Path
+    {
+        char const* name;
+        int  mode;
+        int  oversampling;
+        bool multiCore;
+        Verify::Tolerances tolerances;
+    };
+
+    //Every path follows the bands with envelopes rather than the reference's block RMS, so none of
+    //them matches it sample for sample and all are held mainly to the band and spectral checks.
+    //Tolerances leave a few dB over what the corpus measures at 48 kHz with 256-sample blocks.
+    Path const paths[] =
+    {
+        { "filter_bank",    VocoderEngine::filterBankMode, VocoderEngine::oversamplingOff,   false, {  1.0,  8.0, 12.0 } },
+        { "multi_core",     VocoderEngine::filterBankMode, VocoderEngine::oversamplingOff,   true,  {  1.0,  8.0, 12.0 } },
+        { "oversampled_2x", VocoderEngine::filterBankMode, VocoderEngine::oversampling2x,    false, {  3.0, 11.0, 16.0 } },
+        { "multirate",      VocoderEngine::multirateMode,  VocoderEngine::oversamplingOff,   false, {  1.0,  8.0, 12.0 } },
+        { "spectral",       VocoderEngine::spectralMode,   VocoderEngine::oversamplingOff,   false, {  3.0, 21.0, 20.0 } }
+    };
+
+    //Metrics count as improved only beyond this, so measurement noise cannot excuse a slowdown
+    double constexpr improvementDb = 0.1;
+
+
+    //==============================================================================
+    juce::AudioBuffer<float> makeSweep(double sampleRate, int numSamples)
+    {
+        juce::AudioBuffer<float> signal (2, numSamples);
+
+        //Exponential sweep over the whole band, quieter on the right
+        auto const low   = 30.0;
+        auto const high  = 0.45 * sampleRate;
+        auto const rate  = std::log(high / low) / numSamples;
+        double phase     = 0.0;
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            auto const sample = static_cast<float>(0.5 * std::sin(phase));
+            signal.setSample(0, i, sample);
+            signal.setSample(1, i, 0.5f * sample);
+
+            phase += juce::MathConstants<double>::twoPi * low * std::exp(rate * i) / sampleRate;
+        }
+
+        return signal;
+    }
+
+
+    juce::AudioBuffer<float> makeNoise(int numSamples, juce::int64 seed)
+    {
+        juce::AudioBuffer<float> signal (2, numSamples);
+        juce::Random random (seed);
+
+        for (int channel = 0; channel < 2; channel++)
+            for (int i = 0; i < numSamples; i++)
+                signal.setSample(channel, i, 0.3f * (random.nextFloat() * 2.f - 1.f));
+
+        return signal;
+    }
+
+
+    juce::AudioBuffer<float> makeSaw(double sampleRate, int numSamples, double frequency)
+    {
+        juce::AudioBuffer<float> signal (2, numSamples);
+
+        //Slightly detuned on the right, so the channels are not identical
+        for (int channel = 0; channel < 2; channel++)
+        {
+            auto const increment = frequency * (1.0 + 0.005 * channel) / sampleRate;
+            double phase = 0.0;
+
+            for (int i = 0; i < numSamples; i++)
+            {
+                signal.setSample(channel, i, static_cast<float>(0.3 * (2.0 * phase - 1.0)));
+                phase += increment;
+                phase -= std::floor(phase);
+            }
+        }
+
+        return signal;
+    }
+
+
+    /** Glottal pulses through three formant resonators, in syllables with pauses between
+        some of them, so the onsets and the silences of speech are both covered. */
+    juce::AudioBuffer<float> makeSpeech(double sampleRate, int numSamples)
+    {
+        struct Vowel { double f1, f2, f3; };
+        Vowel const vowels[] = { {700, 1220, 2600}, {300, 2300, 3000}, {500, 900, 2400}, {400, 2000, 2550} };
+
+        int constexpr numFormants = 3;
+        auto const syllableLength = static_cast<int>(0.25 * sampleRate);
+        double const twoPi        = juce::MathConstants<double>::twoPi;
+
+        juce::AudioBuffer<float> signal (2, numSamples);
+        double pulsePhase = 0.0;
+        double state[numFormants][2] = {};
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            int const syllable = i / syllableLength;
+            auto const& vowel  = vowels[syllable % 4];
+            double const f[numFormants] = { vowel.f1, vowel.f2, vowel.f3 };
+
+            //Every third syllable is a pause; the others rise and fall like sin^2
+            auto const position = static_cast<double>(i % syllableLength) / syllableLength;
+            auto const envelope = syllable % 3 == 2 ? 0.0 : std::pow(std::sin(juce::MathConstants<double>::pi * position), 2.0);
+
+            auto const pitch = 120.0 * (1.0 + 0.05 * std::sin(twoPi * 5.0 * i / sampleRate));
+            pulsePhase += pitch / sampleRate;
+
+            double x = 0.0;
+            if (pulsePhase >= 1.0){pulsePhase -= 1.0; x = envelope;}
+
+            double sum = 0.0;
+
+            for (int k = 0; k < numFormants; k++)
+            {
+                auto const radius = std::exp(-juce::MathConstants<double>::pi * 80.0 / sampleRate);
+                auto const a1     = -2.0 * radius * std::cos(twoPi * f[k] / sampleRate);
+                auto const a2     = radius * radius;
+                auto const y      = (1.0 - radius) * x - a1 * state[k][0] - a2 * state[k][1];
+
+                state[k][1] = state[k][0];
+                state[k][0] = y;
+                sum += y;
+            }
+
+            signal.setSample(0, i, static_cast<float>(sum));
+        }
+
+        //The right channel is a quieter copy arriving a little later
+        auto const peak = signal.getMagnitude(0, 0, numSamples);
+        if (peak > 0.f){signal.applyGain(0, 0, numSamples, 0.5f / peak);}
+
+        for (int i = 0; i < numSamples; i++)
+            signal.setSample(1, i, i >= 11 ? 0.8f * signal.getSample(0, i - 11) : 0.f);
+
+        return signal;
+    }
+
+
+    //==============================================================================
+    /** Feeds the modulator through the engine block by block, with the carrier passed in
+        the way a sidechain would be. Returns the seconds spent in process(). */
+    double render(VocoderEngine& engine, juce::AudioBuffer<float> const& modulator, juce::AudioBuffer<float> const& carrier,
+                  juce::AudioBuffer<float>& output, int blockSize, VocoderParameters const& parameters)
+    {
+        int const numSamples = modulator.getNumSamples();
+        output.makeCopyOf(modulator);
+
+        juce::AudioBuffer<float> block (output.getNumChannels(), blockSize);
+        float const* carrierPointers[FilterBank::maxChannels] = {};
+        double seconds = 0.0;
+
+        for (int position = 0; position < numSamples; position += blockSize)
+        {
+            auto const n = juce::jmin(blockSize, numSamples - position);
+            block.setSize(output.getNumChannels(), n, false, false, true);
+
+            for (int channel = 0; channel < output.getNumChannels(); channel++)
+                block.copyFrom(channel, 0, output, channel, position, n);
+
+            for (int channel = 0; channel < carrier.getNumChannels(); channel++)
+                carrierPointers[channel] = carrier.getReadPointer(channel, position);
+
+            auto const start = juce::Time::getHighResolutionTicks();
+            engine.process(block, carrierPointers, carrier.getNumChannels(), parameters);
+            seconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            for (int channel = 0; channel < output.getNumChannels(); channel++)
+                output.copyFrom(channel, position, block, channel, 0, n);
+        }
+
+        return seconds;
+    }
+
+
+    /** Error energy relative to the reference, with the output read latency samples later. */
+    double getSampleErrorDb(juce::AudioBuffer<float> const& reference, juce::AudioBuffer<float> const& output, int latency, int length)
+    {
+        double error = 0.0, energy = 0.0;
+
+        for (int channel = 0; channel < reference.getNumChannels(); channel++)
+        {
+            for (int i = 0; i < length; i++)
+            {
+                auto const r = static_cast<double>(reference.getSample(channel, i));
+                auto const d = static_cast<double>(output.getSample(channel, i + latency)) - r;
+                error  += d * d;
+                energy += r * r;
+            }
+        }
+
+        return 10.0 * std::log10((error + 1.0e-30) / (energy + 1.0e-30));
+    }
+
+
+    /** Largest level difference of any band within 40 dB of the loudest one. */
+    double getBandErrorDb(ReferenceVocoder const& bands, juce::AudioBuffer<float> const& reference,
+                          juce::AudioBuffer<float> const& output, int latency, int length)
+    {
+        auto const expected = bands.getBandEnergies(reference, 0, length);
+        auto const measured = bands.getBandEnergies(output, latency, length);
+        auto const loudest  = *std::max_element(expected.begin(), expected.end());
+
+        double worst = 0.0;
+
+        for (size_t band = 0; band < expected.size(); band++)
+        {
+            if (expected[band] < loudest * 1.0e-4){continue;}
+            worst = juce::jmax(worst, std::abs(10.0 * std::log10((measured[band] + 1.0e-30) / expected[band])));
+        }
+
+        return worst;
+    }
+
+
+    /** Log-spectral distance between Hann-windowed frames of the two signals, averaged over the
+        frames where the reference is within 60 dB of its loudest frame, for bins inside the band range. */
+    double getSpectralDistanceDb(juce::AudioBuffer<float> const& reference, juce::AudioBuffer<float> const& output,
+                                 int latency, int length, double sampleRate, BandLayout const& layout)
+    {
+        int constexpr order   = 11;
+        int constexpr size    = 1 << order;
+        int constexpr hopSize = size / 2;
+
+        juce::dsp::FFT fft (order);
+        std::vector<float> window (size), frame (2 * size);
+
+        for (int k = 0; k < size; k++)
+            window[static_cast<size_t>(k)] = static_cast<float>(0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * k / size));
+
+        auto const firstBin = juce::jmax(1, static_cast<int>(layout.lowFreq * size / sampleRate));
+        auto const lastBin  = juce::jmin(size / 2, static_cast<int>(juce::jmin(static_cast<double>(layout.highFreq), 0.45 * sampleRate) * size / sampleRate));
+
+        //Power spectra of every frame, mixed down over the channels
+        auto const analyse = [&] (juce::AudioBuffer<float> const& signal, int offset)
+        {
+            std::vector<std::vector<double>> spectra;
+
+            for (int start = 0; start + size <= length; start += hopSize)
+            {
+                std::vector<double> power (static_cast<size_t>(lastBin - firstBin));
+
+                for (int channel = 0; channel < signal.getNumChannels(); channel++)
+                {
+                    std::fill(frame.begin(), frame.end(), 0.f);
+                    for (int k = 0; k < size; k++)
+                        frame[static_cast<size_t>(k)] = signal.getSample(channel, offset + start + k) * window[static_cast<size_t>(k)];
+
+                    fft.performRealOnlyForwardTransform(frame.data(), true);
+
+                    for (int bin = firstBin; bin < lastBin; bin++)
+                    {
+                        auto const re = static_cast<double>(frame[static_cast<size_t>(2 * bin)]);
+                        auto const im = static_cast<double>(frame[static_cast<size_t>(2 * bin + 1)]);
+                        power[static_cast<size_t>(bin - firstBin)] += re * re + im * im;
+                    }
+                }
+
+                spectra.push_back(std::move(power));
+            }
+
+            return spectra;
+        };
+
+        auto const expected = analyse(reference, 0);
+        auto const measured = analyse(output, latency);
+
+        std::vector<double> frameEnergy;
+        for (auto const& power : expected){frameEnergy.push_back(std::accumulate(power.begin(), power.end(), 0.0));}
+        if (frameEnergy.empty()){return 0.0;}
+
+        auto const loudest = *std::max_element(frameEnergy.begin(), frameEnergy.end());
+        double total = 0.0;
+        int numFrames = 0;
+
+        for (size_t f = 0; f < expected.size(); f++)
+        {
+            if (frameEnergy[f] < loudest * 1.0e-6 || frameEnergy[f] <= 0.0){continue;}
+
+            //Bins far below the loudest one of the frame would only measure noise
+            auto const floor = *std::max_element(expected[f].begin(), expected[f].end()) * 1.0e-6;
+            double sum = 0.0;
+
+            for (size_t bin = 0; bin < expected[f].size(); bin++)
+            {
+                auto const difference = 10.0 * std::log10((measured[f][bin] + floor) / (expected[f][bin] + floor));
+                sum += difference * difference;
+            }
+
+            total += std::sqrt(sum / static_cast<double>(expected[f].size()));
+            numFrames++;
+        }
+
+        return numFrames > 0 ? total / numFrames : 0.0;
+    }
+
+
+    //==============================================================================
+    juce::var toVar(Verify::Result const& r)
+    {
+        auto* row = new juce::DynamicObject();
+        row->setProperty("path", r.path);
+        row->setProperty("signal", r.signal);
+        row->setProperty("sample_error_db", r.sampleErrorDb);
+        row->setProperty("band_error_db", r.bandErrorDb);
+        row->setProperty("spectral_distance_db", r.spectralDistanceDb);
+        row->setProperty("ns_per_sample", r.nanosecondsPerSample);
+        row->setProperty("speedup", r.speedup);
+        return juce::var(row);
+    }
+
+
+    /** Slower than the baseline by more than the allowance, with no metric better than it was.
+        Speed is compared as the speedup over the reference timed in the same run, so a baseline
+        saved on one machine still means something on another. */
+    bool isRegression(Verify::Result const& r, juce::var const& baseline, double maxSlowdown)
+    {
+        if (! baseline.isArray()){return false;}
+
+        for (auto const& row : *baseline.getArray())
+        {
+            if (row["path"].toString() != r.path || row["signal"].toString() != r.signal){continue;}
+
+            bool const slower   = r.speedup * (1.0 + maxSlowdown) < static_cast<double>(row["speedup"]);
+            bool const improved = r.sampleErrorDb      < static_cast<double>(row["sample_error_db"]) - improvementDb
+                               || r.bandErrorDb        < static_cast<double>(row["band_error_db"]) - improvementDb
+                               || r.spectralDistanceDb < static_cast<double>(row["spectral_distance_db"]) - improvementDb;
+
+            return slower && ! improved;
+        }
+
+        return false;
+    }
+}
+
+
+Verify::Options Verify::parseOptions(juce::ArgumentList const& args)
+{
+    Options options;
+
+    if (args.containsOption("--rate"))        {options.sampleRate = juce::jmax(8000.0, args.getValueForOption("--rate").getDoubleValue());}
+    if (args.containsOption("--block"))       {options.blockSize = juce::jmax(1, args.getValueForOption("--block").getIntValue());}
+    if (args.containsOption("--seconds"))     {options.seconds = juce::jmax(0.1, args.getValueForOption("--seconds").getDoubleValue());}
+    if (args.containsOption("--repeats"))     {options.repeats = juce::jmax(1, args.getValueForOption("--repeats").getIntValue());}
+    if (args.containsOption("--baseline"))    {options.baseline = args.getExistingFileForOption("--baseline");}
+    if (args.containsOption("--save"))        {options.save = args.getFileForOption("--save");}
+    if (args.containsOption("--max-slowdown")){options.maxSlowdown = juce::jmax(0.0, args.getValueForOption("--max-slowdown").getDoubleValue());}
+
+    return options;
+}
+
+
+int Verify::run(ParameterSet const& parameterSet, Options const& options)
+{
+    auto const sampleRate = options.sampleRate;
+    auto const numSamples = static_cast<int>(options.seconds * sampleRate);
+
+    struct Signal
+    {
+        char const* name;
+        juce::AudioBuffer<float> modulator, carrier;
+    };
+
+    Signal const corpus[] =
+    {
+        { "sweep",  makeSweep(sampleRate, numSamples),  makeSaw(sampleRate, numSamples, 110.0) },
+        { "noise",  makeNoise(numSamples, 1),           makeSaw(sampleRate, numSamples, 110.0) },
+        { "speech", makeSpeech(sampleRate, numSamples), makeNoise(numSamples, 2) }
+    };
+
+    auto parameters = parameterSet.parameters;
+    parameters.carrier = VocoderEngine::sidechainCarrier;
+
+    //The reference only knows the second-order bands the plugin started with
+    auto layout = parameterSet.layout;
+    layout.numSections = 1;
+
+    ReferenceVocoder const reference (sampleRate, layout, parameters);
+    auto const baseline = options.baseline.existsAsFile() ? juce::JSON::parse(options.baseline) : juce::var();
+
+    juce::Array<juce::var> results;
+    int numFailed = 0;
+
+    std::cout << "path,signal,sample_error_db,band_error_db,spectral_distance_db,ns_per_sample,speedup,status" << std::endl;
+
+    for (auto const& signal : corpus)
+    {
+        juce::AudioBuffer<float> expected;
+        double referenceSeconds = std::numeric_limits<double>::max();
+
+        for (int repeat = 0; repeat < options.repeats; repeat++)
+        {
+            auto const start = juce::Time::getHighResolutionTicks();
+            reference.process(signal.modulator, signal.carrier, expected, options.blockSize);
+            referenceSeconds = juce::jmin(referenceSeconds, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+        }
+
+        for (auto const& path : paths)
+        {
+            auto settings = parameters;
+            settings.mode        = path.mode;
+            settings.multiCore   = path.multiCore;
+            settings.nonRealtime = path.multiCore;
+
+            VocoderEngine engine;
+            if (path.multiCore){engine.createWorkerPool();}
+
+            juce::AudioBuffer<float> output;
+            double best = std::numeric_limits<double>::max();
+            auto const numChannels = juce::jmax(signal.modulator.getNumChannels(), signal.carrier.getNumChannels());
+
+            for (int repeat = 0; repeat < options.repeats; repeat++)
+            {
+                engine.prepare(sampleRate, options.blockSize, numChannels, layout, path.oversampling);
+                best = juce::jmin(best, render(engine, signal.modulator, signal.carrier, output, options.blockSize, settings));
+            }
+
+            auto const latency = engine.getLatencySamples(path.mode);
+            auto const length  = numSamples - latency;
+
+            Result r;
+            r.path                 = path.name;
+            r.signal               = signal.name;
+            r.sampleErrorDb        = getSampleErrorDb(expected, output, latency, length);
+            r.bandErrorDb          = getBandErrorDb(reference, expected, output, latency, length);
+            r.spectralDistanceDb   = getSpectralDistanceDb(expected, output, latency, length, sampleRate, layout);
+            r.nanosecondsPerSample = best * 1.0e9 / numSamples;
+            r.speedup              = referenceSeconds / best;
+
+            juce::StringArray failures;
+            if (r.sampleErrorDb      > path.tolerances.sampleErrorDb)      failures.add("sample_error");
+            if (r.bandErrorDb        > path.tolerances.bandErrorDb)        failures.add("band_error");
+            if (r.spectralDistanceDb > path.tolerances.spectralDistanceDb) failures.add("spectral_distance");
+            if (isRegression(r, baseline, options.maxSlowdown))            failures.add("slower_without_gain");
+
+            numFailed += failures.size();
+            results.add(toVar(r));
+
+            std::cout << r.path << ',' << r.signal << ',' << r.sampleErrorDb << ',' << r.bandErrorDb << ','
+                      << r.spectralDistanceDb << ',' << r.nanosecondsPerSample << ',' << r.speedup << ','
+                      << (failures.isEmpty() ? juce::String("ok") : failures.joinIntoString("+")) << std::endl;
+        }
+    }
+
+    if (options.save != juce::File())
+        options.save.replaceWithText(juce::JSON::toString(juce::var(results)));
+
+    return numFailed;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSet.h"
+
+//==============================================================================
+/**
+    Differential check of the engine's optimised paths against ReferenceVocoder, the
+    plugin's original algorithm.
+
+    A corpus of generated signals (a sweep, noise and a speech-like pulse train) is
+    vocoded by the reference and by every path, each fed the same external carrier.
+    The outputs are compared sample by sample, by the energy in each band and by the
+    log-spectral distance, against tolerances per path. Given a baseline from an earlier
+    run, such as the baseline.json checked in with this tool, a path whose speedup over
+    the reference dropped without it getting more accurate fails as well.
+*/
+struct Verify
+{
+    struct Options
+    {
+        double sampleRate{48000.0};
+        int    blockSize{256};
+        double seconds{2.0};
+        int    repeats{3};
+
+        //Results of an earlier run to compare speed against, if any, and where to save this one
+        juce::File baseline, save;
+
+        //Drop in speedup a path may show against the baseline without improving any metric
+        double maxSlowdown{0.1};
+    };
+
+    struct Tolerances
+    {
+        double sampleErrorDb, bandErrorDb, spectralDistanceDb;
+    };
+
+    struct Result
+    {
+        juce::String path, signal;
+        double sampleErrorDb, bandErrorDb, spectralDistanceDb;
+        double nanosecondsPerSample;
+
+        //Time the reference took for the same signal divided by the time of this path
+        double speedup;
+    };
+
+    /** Options come from --rate=, --block=, --seconds=, --repeats=, --baseline=, --save=
+        and --max-slowdown= (a fraction, 0.1 by default). Speed is only checked when
+        --baseline names a file. */
+    static Options parseOptions(juce::ArgumentList const& args);
+
+    /** Runs every path on every signal, prints one CSV row per pair and returns the
+        number of failed checks. */
+    static int run(ParameterSet const& parameterSet, Options const& options);
+};
@@ -0,0 +1,76 @@
+#include <JuceHeader.h>
+#include "../../../Source/VocoderEngine.h"
+
+//==============================================================================
+/** Routing and determinism checks of VocoderEngine that the verify corpus does not cover. */
+class EngineTest : public juce::UnitTest
+{
+public:
+
+    EngineTest() : juce::UnitTest("Engine", "Vocoder") {}
+
+    void runTest() override
+    {
+        beginTest("Switched carrier and modulator");
+        {
+            //With switch_car_mod the input is the carrier, so it has to be read before the output is written over it
+            VocoderParameters parameters;
+            parameters.switchCarrMod = true;
+
+            VocoderEngine engine;
+            engine.prepare(sampleRate, blockSize, 2, BandLayout());
+
+            auto buffer = makeNoise(2, numSamples, 1);
+            render(engine, buffer, parameters);
+
+            for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+                expectGreaterThan(buffer.getRMSLevel(channel, numSamples / 2, numSamples / 2), 1.0e-3f, "Switched output is silent");
+        }
+
+        beginTest("Channels past the prepared ones");
+        {
+            //The oversampling stages only hold the prepared channel, so the second one is a copy
+            VocoderEngine engine;
+            engine.prepare(sampleRate, blockSize, 1, BandLayout(), VocoderEngine::oversampling2x);
+
+            auto buffer = makeNoise(2, numSamples, 1);
+            render(engine, buffer, VocoderParameters());
+
+            expectGreaterThan(buffer.getRMSLevel(0, numSamples / 2, numSamples / 2), 1.0e-3f, "Oversampled output is silent");
+            expect(std::memcmp(buffer.getReadPointer(0), buffer.getReadPointer(1), sizeof(float) * numSamples) == 0,
+                   "The extra channel is not a copy of the first");
+        }
+    }
+
+private:
+
+    static juce::AudioBuffer<float> makeNoise(int numChannels, int length, juce::int64 seed)
+    {
+        juce::AudioBuffer<float> signal (numChannels, length);
+        juce::Random random (seed);
+
+        for (int channel = 0; channel < numChannels; channel++)
+            for (int i = 0; i < length; i++)
+                signal.setSample(channel, i, 0.3f * (random.nextFloat() * 2.f - 1.f));
+
+        return signal;
+    }
+
+
+    /** Runs the engine over the buffer in place, one host block at a time. */
+    static void render(VocoderEngine& engine, juce::AudioBuffer<float>& buffer, VocoderParameters const& parameters)
+    {
+        for (int position = 0; position < buffer.getNumSamples(); position += blockSize)
+        {
+            auto const n = juce::jmin(blockSize, buffer.getNumSamples() - position);
+            juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), position, n);
+            engine.process(block, parameters);
+        }
+    }
+
+    double constexpr static sampleRate = 48000.0;
+    int    constexpr static blockSize  = 256;
+    int    constexpr static numSamples = 48000;
+};
+
+static EngineTest engineTest;
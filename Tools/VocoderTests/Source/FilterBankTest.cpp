@@ -0,0 +1,132 @@
+#include <JuceHeader.h>
+#include "../../../Source/FilterBank.h"
+
+//==============================================================================
+/** Checks of FilterBank that need bit-exact answers rather than the tolerances of verify. */
+class FilterBankTest : public juce::UnitTest
+{
+public:
+
+    FilterBankTest() : juce::UnitTest("Filter bank", "Vocoder") {}
+
+    void runTest() override
+    {
+        beginTest("Partition by partition gives the same bits as one pass");
+        {
+            //Three partitions, so some can go idle while others still ring out
+            BandLayout layout;
+            layout.sampleRate = sampleRate;
+            layout.numBands   = 48;
+            layout.lowFreq    = 50.f;
+            layout.wide       = 1.1f;
+
+            auto design = std::make_unique<FilterBankDesign>();
+            design->compute(layout);
+
+            //One bank runs every partition in one call, as process() does, the other one call
+            //per partition with the partial outputs added in order, as the worker pool does.
+            //A short release lets the bands die away within the quiet part of the modulator.
+            auto serial      = std::make_unique<FilterBank>();
+            auto partitioned = std::make_unique<FilterBank>();
+
+            for (auto* bank : { serial.get(), partitioned.get() })
+            {
+                bank->setDesign(*design);
+                bank->setEnvelope(sampleRate, 5.f, 10.f, FilterBank::Detector::rms);
+            }
+
+            expectGreaterThan(serial->getNumPartitions(), 2);
+
+            auto const modulator = makeModulator();
+            auto const carrier   = makeNoise(numSamples, 2);
+
+            juce::AudioBuffer<float> serialOutput (numChannels, numSamples), partitionedOutput (numChannels, numSamples);
+            juce::AudioBuffer<float> partials (numChannels * FilterBank::maxPartitions, blockSize);
+
+            for (int position = 0; position < numSamples; position += blockSize)
+            {
+                auto const n = juce::jmin(blockSize, numSamples - position);
+                float const* mod[numChannels];
+                float const* car[numChannels];
+                float* out[numChannels];
+
+                for (int channel = 0; channel < numChannels; channel++)
+                {
+                    mod[channel] = modulator.getReadPointer(channel, position);
+                    car[channel] = carrier.getReadPointer(channel, position);
+                    out[channel] = serialOutput.getWritePointer(channel, position);
+                }
+
+                serial->process(mod, numChannels, car, out, numChannels, n, modGain);
+
+                for (int p = 0; p < partitioned->getNumPartitions(); p++)
+                {
+                    float* partial[numChannels];
+                    for (int channel = 0; channel < numChannels; channel++){partial[channel] = partials.getWritePointer(p * numChannels + channel);}
+
+                    partitioned->processPartitions(p, p + 1, mod, numChannels, car, partial, numChannels, n, modGain);
+                }
+
+                partitioned->endBlock(n);
+
+                for (int channel = 0; channel < numChannels; channel++)
+                {
+                    auto* sum = partitionedOutput.getWritePointer(channel, position);
+                    juce::FloatVectorOperations::copy(sum, partials.getReadPointer(channel), n);
+
+                    for (int p = 1; p < partitioned->getNumPartitions(); p++)
+                        juce::FloatVectorOperations::add(sum, partials.getReadPointer(p * numChannels + channel), n);
+                }
+            }
+
+            for (int channel = 0; channel < numChannels; channel++)
+            {
+                expect(std::memcmp(serialOutput.getReadPointer(channel), partitionedOutput.getReadPointer(channel),
+                                   sizeof(float) * static_cast<size_t>(numSamples)) == 0, "Outputs differ");
+            }
+        }
+    }
+
+private:
+
+    static juce::AudioBuffer<float> makeNoise(int length, juce::int64 seed)
+    {
+        juce::AudioBuffer<float> signal (numChannels, length);
+        juce::Random random (seed);
+
+        for (int channel = 0; channel < numChannels; channel++)
+            for (int i = 0; i < length; i++)
+                signal.setSample(channel, i, 0.3f * (random.nextFloat() * 2.f - 1.f));
+
+        return signal;
+    }
+
+
+    /** Noise, then a tone with a little noise on it, all just under the silence threshold:
+        the tone keeps its own bands ringing while the others go idle and still pick up the
+        noise. Then noise again, which shows any state left behind in the idle bands. */
+    static juce::AudioBuffer<float> makeModulator()
+    {
+        auto signal = makeNoise(numSamples, 1);
+        auto const quiet = makeNoise(numSamples, 3);
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            for (int i = numSamples / 3; i < 2 * numSamples / 3; i++)
+            {
+                auto const tone = 0.7f * static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * 300.0 * i / sampleRate));
+                signal.setSample(channel, i, FilterBank::silenceLevel * (tone + quiet.getSample(channel, i) / 1.5f));
+            }
+        }
+
+        return signal;
+    }
+
+    double constexpr static sampleRate  = 48000.0;
+    int    constexpr static blockSize   = 256;
+    int    constexpr static numSamples  = 48000;
+    int    constexpr static numChannels = 2;
+    float  constexpr static modGain     = 2.f;
+};
+
+static FilterBankTest filterBankTest;
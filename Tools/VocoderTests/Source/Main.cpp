@@ -0,0 +1,27 @@
+/*
+  ==============================================================================
+
+    Runs the vocoder's unit tests. Returns 1 if any of them failed, so a build
+    script or CI job can stop on it.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ignoreUnused (argc, argv);
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runTestsInCategory ("Vocoder");
+
+    int numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); i++)
+        numFailures += runner.getResult (i)->failures;
+
+    return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+#include <JuceHeader.h>
+#include "../../VocoderRender/Source/Verify.h"
+
+//==============================================================================
+/**
+    Runs the render tool's verify command with the plugin's default settings: every
+    path against the frozen reference. Speed against baseline.json is left to the
+    command itself, since timings on a shared build machine are not repeatable.
+*/
+class VerifyTest : public juce::UnitTest
+{
+public:
+
+    VerifyTest() : juce::UnitTest("Verify", "Vocoder") {}
+
+    void runTest() override
+    {
+        beginTest("Paths against the reference");
+
+        //Without a baseline only the accuracy is checked, so one run of each path is enough
+        auto options = Verify::parseOptions(juce::ArgumentList("VocoderTests", juce::StringArray()));
+        options.repeats = 1;
+
+        expectEquals(Verify::run(ParameterSet(), options), 0, "Checks failed, see the rows marked above");
+    }
+};
+
+static VerifyTest verifyTest;
@@ -0,0 +1,65 @@
+#include <JuceHeader.h>
+#include "../../../Source/BandWorkerPool.h"
+
+//==============================================================================
+/** Every task of every job runs exactly once, whether the workers are spinning, parked
+    or busy with another caller's job. */
+class WorkerPoolTest : public juce::UnitTest
+{
+public:
+
+    WorkerPoolTest() : juce::UnitTest("Worker pool", "Vocoder") {}
+
+    void runTest() override
+    {
+        BandWorkerPool pool (numWorkers);
+
+        beginTest("Back to back jobs");
+        expect(runJobs(pool, 2000, 0), "A task was skipped or run twice");
+
+        beginTest("Jobs after the workers park");
+        expect(runJobs(pool, 20, 5), "A task was skipped or run twice");
+
+        beginTest("Two callers at once");
+        {
+            std::atomic<bool> other{false};
+            std::thread caller ([&] { other = runJobs(pool, 500, 0); });
+            auto const own = runJobs(pool, 500, 0);
+            caller.join();
+
+            expect(own && other, "A task was skipped or run twice");
+        }
+    }
+
+private:
+
+    int constexpr static numWorkers = 3;
+    int constexpr static numTasks   = 8;
+
+    struct Job
+    {
+        std::atomic<int> counts[numTasks];
+    };
+
+    static bool runJobs(BandWorkerPool& pool, int numJobs, int pauseMs)
+    {
+        for (int i = 0; i < numJobs; i++)
+        {
+            Job job;
+            for (auto& count : job.counts){count = 0;}
+
+            pool.run(numTasks, [] (void* context, int task)
+            {
+                static_cast<Job*>(context)->counts[task]++;
+            }, &job);
+
+            for (auto& count : job.counts){if (count != 1){return false;}}
+
+            if (pauseMs > 0){juce::Thread::sleep(pauseMs);}
+        }
+
+        return true;
+    }
+};
+
+static WorkerPoolTest workerPoolTest;